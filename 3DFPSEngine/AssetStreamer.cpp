@@ -0,0 +1,151 @@
+#include "AssetStreamer.h"
+#include "ThreadPool.h"
+#include "FileSystem.h"
+
+#include <chrono>
+#include <iostream>
+
+AssetStreamer& AssetStreamer::Get()
+{
+	static AssetStreamer streamer;
+	return streamer;
+}
+
+shared_ptr<Model> AssetStreamer::LoadModelAsync(const string& path, CPUDataPolicy policy)
+{
+	// a model that is still alive is shared, which also lets RenderQueue draw its copies instanced
+	string key = CanonicalPath(path);
+	for (const LoadedModel& loaded : m_loaded)
+		if (loaded.key == key && loaded.policy == policy)
+			if (shared_ptr<Model> model = loaded.model.lock())
+				return model;
+
+	Job job;
+	job.model = make_shared<Model>(policy);
+	job.path = path;
+	job.loading = ThreadPool::Get().Submit([path]() { return Model::LoadData(path); });
+	m_jobs.push_back(std::move(job));
+
+	LoadedModel loaded;
+	loaded.path = path;
+	loaded.key = key;
+	loaded.model = m_jobs.back().model;
+	loaded.policy = policy;
+	m_loaded.push_back(loaded);
+
+	return m_jobs.back().model;
+}
+
+bool AssetStreamer::ReloadFile(const string& path)
+{
+	string key = CanonicalPath(path);
+	string directory = key.substr(0, key.find_last_of('/') + 1);
+	// the importer reads .mtl files next to the model, the models of the directory that name it get a new cache
+	// key and are imported again, the others load their cache unchanged
+	bool material = GetExtension(key) == ".mtl";
+
+	bool reloaded = false;
+	for (auto it = m_loaded.begin(); it != m_loaded.end();)
+	{
+		shared_ptr<Model> model = it->model.lock();
+		if (!model)
+		{
+			it = m_loaded.erase(it);
+			continue;
+		}
+
+		bool source = it->key == key;
+		bool depends = source || (material && it->key.compare(0, directory.size(), directory) == 0 && it->key.find('/', directory.size()) == string::npos);
+		if (depends && model->IsInSharedArena())
+		{
+			// its old ranges could never be returned to the shared arena, every reload would leak them
+			cout << "ERROR::ASSET_STREAMER::SHARED_ARENA_NOT_RELOADABLE " << it->path << endl;
+		}
+		else if (depends)
+		{
+			// a reload that is still in flight would switch the model back to older data when it finishes
+			m_jobs.remove_if([&](const Job& job) { return job.target == model; });
+
+			Job job;
+			job.model = make_shared<Model>(it->policy);
+			job.target = model;
+			job.path = it->path;
+			string modelPath = it->path;
+			job.loading = ThreadPool::Get().Submit([modelPath]() { return Model::LoadData(modelPath); });
+			m_jobs.push_back(std::move(job));
+			reloaded = true;
+		}
+		++it;
+	}
+	return reloaded;
+}
+
+void AssetStreamer::Update()
+{
+	typedef chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double, std::milli>(m_budget.milliseconds));
+	size_t bytes = 0;
+	bool first = true;
+
+	auto withinBudget = [&]()
+	{
+		return first || (bytes < m_budget.bytes && Clock::now() < deadline);
+	};
+
+	for (auto it = m_jobs.begin(); it != m_jobs.end() && withinBudget();)
+	{
+		Job& job = *it;
+		if (!job.data)
+		{
+			// still parsing on the thread pool, come back next frame
+			if (job.loading.wait_for(chrono::seconds(0)) != future_status::ready)
+			{
+				++it;
+				continue;
+			}
+			job.data = job.loading.get();
+
+			// a reload that failed to import (e.g. the file was caught mid save) would never become resident,
+			// the model keeps its old data until the next change
+			if (job.target && job.data->meshes.empty())
+			{
+				cout << "ERROR::ASSET_STREAMER::RELOAD_FAILED " << job.path << endl;
+				it = m_jobs.erase(it);
+				continue;
+			}
+		}
+
+		while (job.nextMesh < job.data->meshes.size() && withinBudget())
+		{
+			bytes += job.model->UploadMesh(*job.data, job.nextMesh++);
+			first = false;
+		}
+
+		// the CPU copies (or the cache mapping) are only needed until every mesh is on the GPU
+		if (job.nextMesh < job.data->meshes.size())
+			++it;
+		else if (!job.target)
+			it = m_jobs.erase(it);
+		else if (job.model->IsResident())
+		{
+			// reloads swap in only once the textures are up too, so the model never draws half loaded
+			*job.target = std::move(*job.model);
+			it = m_jobs.erase(it);
+		}
+		else
+			++it;
+	}
+
+	// textures share whatever budget is left. If nothing at all went up this frame, one upload happens even past
+	// the deadline so loads can't stall.
+	if (bytes < m_budget.bytes)
+	{
+		size_t textureBytes = TextureCache::Get().PumpLoads(deadline, m_budget.bytes - bytes);
+		if (first && textureBytes == 0)
+			textureBytes = TextureCache::Get().PumpLoads(Clock::time_point::max(), 1);
+		bytes += textureBytes;
+	}
+
+	// finer mip levels of the textures on screen come last, they are never needed for a first image
+	TextureCache::Get().UpdateStreaming(deadline, bytes < m_budget.bytes ? m_budget.bytes - bytes : 0);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Model.h"
+
+#include <cstddef>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+using namespace std;
+
+// How much GL upload work the streamer may do per frame. At least one upload always happens so loads can't stall.
+struct UploadBudget {
+	double milliseconds = 2.0;
+	size_t bytes = 8 * 1024 * 1024;
+};
+
+// Loads models without blocking the render loop: file I/O, parsing and image decoding run on the thread pool,
+// and the GL buffer/texture creation is drained on the main thread a little every frame.
+class AssetStreamer
+{
+public:
+	static AssetStreamer& Get();
+
+	// starts loading the model and returns it straight away, it stays non resident (Model::IsResident) until
+	// all of its meshes and textures have been uploaded by Update. Loading a file whose model is still in use
+	// returns that model.
+	shared_ptr<Model> LoadModelAsync(const string& path, CPUDataPolicy policy = CPUDataPolicy::Release);
+
+	// loads every model that came from the file (or from a directory whose material library changed) again. The
+	// models keep drawing their current meshes until the new ones are resident and then switch over between
+	// frames. Textures the new meshes share with the old ones are not reloaded. Models in the shared arena
+	// (Model::useSharedArena) are left alone, their geometry could never be freed. Returns whether any model
+	// depends on the file.
+	bool ReloadFile(const string& path);
+
+	// uploads finished loads and streams in texture mip levels within the budget, call once per frame on the GL thread
+	void Update();
+
+	void SetBudget(const UploadBudget& budget) { m_budget = budget; }
+	const UploadBudget& GetBudget() const { return m_budget; }
+
+	size_t GetPendingCount() const { return m_jobs.size(); }
+
+private:
+	AssetStreamer() {}
+
+	struct Job {
+		shared_ptr<Model> model;
+		shared_ptr<Model> target;	// for reloads, the model that takes over 'model' once it is resident
+		string path;
+		future<unique_ptr<ModelData>> loading;
+		unique_ptr<ModelData> data;	// set once loading has finished
+		size_t nextMesh = 0;
+	};
+
+	struct LoadedModel {
+		string path;
+		string key;			// canonical path
+		weak_ptr<Model> model;
+		CPUDataPolicy policy;
+	};
+
+	list<Job> m_jobs;
+	list<LoadedModel> m_loaded;
+	UploadBudget m_budget;
+};
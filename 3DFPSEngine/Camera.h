@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "CameraUniforms.h"
 #include "Transform.h"
 
 #include <vector>
@@ -118,10 +119,15 @@ public:
 			Zoom = 45.0f;
 	}
 
+	// publishes the matrices for this frame, to the transforms and to the shaders through the camera uniform buffer
 	void CopyVectors()
 	{
-		Transform::SetProjectionMatrix(this->GetProjectionMatrix());
-		Transform::SetViewMatrix(this->GetViewMatrix());
+		glm::mat4 projection = this->GetProjectionMatrix();
+		glm::mat4 view = this->GetViewMatrix();
+		Transform::SetProjectionMatrix(projection);
+		Transform::SetViewMatrix(view);
+		Transform::SetViewportHeight(m_screen_height);
+		CameraUniforms::Get().Update(projection, view, Position);
 	}
 
 private:
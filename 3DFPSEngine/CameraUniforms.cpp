@@ -0,0 +1,45 @@
+#include "CameraUniforms.h"
+#include "GLState.h"
+#include "Meshlets.h"
+
+#include <glad/glad.h>
+
+static_assert(sizeof(CameraUniforms::Data) == 6 * 64 + 16 + 6 * 16, "CameraUniforms::Data must match the std140 layout of the Camera block");
+
+const char* const CameraUniforms::BLOCK_NAME = "Camera";
+
+CameraUniforms& CameraUniforms::Get()
+{
+	static CameraUniforms uniforms;
+	return uniforms;
+}
+
+void CameraUniforms::Update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position)
+{
+	if (m_buffer == 0)
+	{
+		glGenBuffers(1, &m_buffer);
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	m_data.view = view;
+	m_data.projection = projection;
+	m_data.viewProjection = projection * view;
+	m_data.inverseView = glm::inverse(view);
+	m_data.inverseProjection = glm::inverse(projection);
+	m_data.inverseViewProjection = glm::inverse(m_data.viewProjection);
+	m_data.cameraPosition = glm::vec4(position, 1.0f);
+
+	// the meshlet cull view with an identity model matrix has the planes in world space
+	MeshletCullView cull = MakeMeshletCullView(projection, view, glm::mat4(1.0f));
+	for (int i = 0; i < 6; i++)
+		m_data.frustumPlanes[i] = cull.planes[i];
+
+	// orphan the old contents, the previous frame may still be reading them
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &m_data);
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, 0);
+	GLState::Get().BindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The per frame camera state every shader reads from one uniform buffer instead of per object uniforms:
+//
+//   layout (std140) uniform Camera {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProjection;
+//       mat4 inverseView;
+//       mat4 inverseProjection;
+//       mat4 inverseViewProjection;
+//       vec4 cameraPosition;		// w is 1
+//       vec4 frustumPlanes[6];		// world space, inside is dot(plane.xyz, p) + plane.w >= 0
+//   };
+//
+// Shaders pick it up by declaring the block, Shader binds every block named BLOCK_NAME to BINDING after linking.
+class CameraUniforms
+{
+public:
+	static const char* const BLOCK_NAME;
+	static const unsigned int BINDING = 0;
+
+	// mirrors the block above, std140 lays it out without padding
+	struct Data {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::mat4 inverseView;
+		glm::mat4 inverseProjection;
+		glm::mat4 inverseViewProjection;
+		glm::vec4 cameraPosition;
+		glm::vec4 frustumPlanes[6];
+	};
+
+	static CameraUniforms& Get();
+
+	// GL thread, once per frame before anything is drawn: fills the buffer and binds it to BINDING
+	void Update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position);
+
+	const Data& GetData() const { return m_data; }
+
+private:
+	CameraUniforms() {}
+	CameraUniforms(const CameraUniforms&) = delete;
+	CameraUniforms& operator=(const CameraUniforms&) = delete;
+
+	unsigned int m_buffer = 0;
+	Data m_data;
+};
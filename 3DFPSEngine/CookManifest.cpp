@@ -0,0 +1,122 @@
+#include "CookManifest.h"
+#include "FileSystem.h"
+#include "PakArchive.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+const char* const CookManifest::DIRECTORY = "./cooked";
+const char* const CookManifest::FILE_NAME = "manifest.txt";
+
+#ifdef NDEBUG
+bool CookManifest::cookedOnly = true;
+#else
+bool CookManifest::cookedOnly = false;
+#endif
+
+CookManifest& CookManifest::Get()
+{
+	static CookManifest manifest(DIRECTORY);
+	return manifest;
+}
+
+string CookManifest::GetOutputName(uint64_t key, const char* extension)
+{
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+	return string(name) + extension;
+}
+
+// one entry per line: <key in hex> <output file name> <canonical source path, may contain spaces>
+bool CookManifest::Load(const string& directory)
+{
+	m_directory = directory;
+	m_entries.clear();
+
+	AssetFile file;
+	if (!file.Open(directory + "/" + FILE_NAME))
+		return false;
+
+	istringstream in(string(reinterpret_cast<const char*>(file.Data()), file.Size()));
+	string line;
+	while (getline(in, line))
+	{
+		istringstream fields(line);
+		string key, output, source;
+		if (!(fields >> key >> output) || !getline(fields >> ws, source) || source.empty())
+		{
+			cout << "ERROR::COOK_MANIFEST::BAD_LINE " << line << endl;
+			continue;
+		}
+
+		Record record;
+		record.output = output;
+		record.key = strtoull(key.c_str(), nullptr, 16);
+		m_entries[source] = record;
+	}
+	return true;
+}
+
+bool CookManifest::Save(const string& directory) const
+{
+	// sorted so the file diffs cleanly between cooks
+	map<string, const Record*> sorted;
+	for (const auto& entry : m_entries)
+		sorted[entry.first] = &entry.second;
+
+	string path = directory + "/" + FILE_NAME;
+	string tempPath = path + ".tmp";
+	{
+		ofstream out(tempPath, ios::trunc);
+		char key[17];
+		for (const auto& entry : sorted)
+		{
+			snprintf(key, sizeof(key), "%016llx", (unsigned long long)entry.second->key);
+			out << key << ' ' << entry.second->output << ' ' << entry.first << '\n';
+		}
+		if (!out)
+		{
+			cout << "ERROR::COOK_MANIFEST::COULD_NOT_WRITE " << tempPath << endl;
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		cout << "ERROR::COOK_MANIFEST::COULD_NOT_WRITE " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+bool CookManifest::Find(const string& sourcePath, Entry& entry) const
+{
+	auto it = m_entries.find(CanonicalPath(sourcePath));
+	if (it == m_entries.end())
+		return false;
+
+	entry.path = m_directory + "/" + it->second.output;
+	entry.key = it->second.key;
+	return true;
+}
+
+void CookManifest::Add(const string& sourcePath, const string& outputName, uint64_t key)
+{
+	Record record;
+	record.output = outputName;
+	record.key = key;
+	m_entries[CanonicalPath(sourcePath)] = record;
+}
+
+bool CookManifest::Contains(const string& outputName) const
+{
+	for (const auto& entry : m_entries)
+		if (entry.second.output == outputName)
+			return true;
+	return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+using namespace std;
+
+// Index of the outputs written by the asset cooker (tools/AssetCook.cpp), keyed by canonical source path.
+// Outputs are named after the hash of everything that went into them (source bytes, dependencies, import
+// settings and format version), so a stale output is never overwritten in place and cooking unchanged inputs
+// finds the output already there. The key is also stored in the output's header and checked on load.
+class CookManifest
+{
+public:
+	static const char* const DIRECTORY;
+	static const char* const FILE_NAME;
+
+	// true in release builds: models and textures load only from cooked outputs and the source assets (and
+	// ASSIMP / stb_image) are never touched at runtime
+	static bool cookedOnly;
+
+	struct Entry {
+		string path;		// cooked output, including the directory
+		uint64_t key = 0;	// hash the output was built from
+	};
+
+	// the manifest in DIRECTORY, read on first use. Safe to call from any thread.
+	static CookManifest& Get();
+
+	CookManifest() {}
+	explicit CookManifest(const string& directory) { Load(directory); }
+
+	bool Load(const string& directory);
+	// writes the manifest next to the outputs, replacing it atomically
+	bool Save(const string& directory) const;
+
+	bool Find(const string& sourcePath, Entry& entry) const;
+	void Add(const string& sourcePath, const string& outputName, uint64_t key);
+	bool Contains(const string& outputName) const;
+
+	size_t GetEntryCount() const { return m_entries.size(); }
+
+	// content addressed file name for an output
+	static string GetOutputName(uint64_t key, const char* extension);
+
+private:
+	struct Record {
+		string output;	// file name within the directory
+		uint64_t key;
+	};
+
+	string m_directory;
+	unordered_map<string, Record> m_entries;
+};
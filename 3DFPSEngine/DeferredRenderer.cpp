@@ -0,0 +1,348 @@
+#include "DeferredRenderer.h"
+#include "GLState.h"
+#include "HotReload.h"
+#include "LightManager.h"
+
+#include <glad/glad.h>
+
+#include <cfloat>
+#include <cmath>
+
+bool DeferredRenderer::enabled = false;
+
+// below this the cone around a spot light gets wider than the sphere around its range
+static const float MIN_CONE_COS = 0.2f;
+
+static const int SPHERE_SEGMENTS = 16;
+static const int SPHERE_RINGS = 8;
+static const int CONE_SEGMENTS = 16;
+
+static void AddVertex(vector<float>& positions, float x, float y, float z)
+{
+	positions.push_back(x);
+	positions.push_back(y);
+	positions.push_back(z);
+}
+
+// unit sphere, pushed out so its flat faces still enclose the round one. Counter-clockwise seen from outside.
+static vector<float> BuildSphere()
+{
+	const float PI = 3.14159265f;
+	float scale = 1.0f / (std::cos(PI / SPHERE_SEGMENTS) * std::cos(PI / (2 * SPHERE_RINGS)));
+	auto point = [&](int ring, int segment, float* out)
+	{
+		float theta = PI * ring / SPHERE_RINGS, phi = 2.0f * PI * segment / SPHERE_SEGMENTS;
+		out[0] = std::sin(theta) * std::cos(phi) * scale;
+		out[1] = std::cos(theta) * scale;
+		out[2] = std::sin(theta) * std::sin(phi) * scale;
+	};
+
+	vector<float> positions;
+	for (int r = 0; r < SPHERE_RINGS; r++)
+	{
+		for (int s = 0; s < SPHERE_SEGMENTS; s++)
+		{
+			float a[3], b[3], c[3], d[3];
+			point(r, s, a);
+			point(r, s + 1, b);
+			point(r + 1, s + 1, c);
+			point(r + 1, s, d);
+			AddVertex(positions, a[0], a[1], a[2]);
+			AddVertex(positions, b[0], b[1], b[2]);
+			AddVertex(positions, c[0], c[1], c[2]);
+			AddVertex(positions, a[0], a[1], a[2]);
+			AddVertex(positions, c[0], c[1], c[2]);
+			AddVertex(positions, d[0], d[1], d[2]);
+		}
+	}
+	return positions;
+}
+
+// cone with its apex at the origin opening along +z to a unit radius cap at z = 1, pushed out like the sphere
+static vector<float> BuildCone()
+{
+	const float PI = 3.14159265f;
+	float scale = 1.0f / std::cos(PI / CONE_SEGMENTS);
+
+	vector<float> positions;
+	for (int s = 0; s < CONE_SEGMENTS; s++)
+	{
+		float phi0 = 2.0f * PI * s / CONE_SEGMENTS, phi1 = 2.0f * PI * (s + 1) / CONE_SEGMENTS;
+		float x0 = std::cos(phi0) * scale, y0 = std::sin(phi0) * scale;
+		float x1 = std::cos(phi1) * scale, y1 = std::sin(phi1) * scale;
+		// side
+		AddVertex(positions, 0.0f, 0.0f, 0.0f);
+		AddVertex(positions, x1, y1, 1.0f);
+		AddVertex(positions, x0, y0, 1.0f);
+		// cap
+		AddVertex(positions, 0.0f, 0.0f, 1.0f);
+		AddVertex(positions, x0, y0, 1.0f);
+		AddVertex(positions, x1, y1, 1.0f);
+	}
+	return positions;
+}
+
+DeferredRenderer::DeferredRenderer()
+	: m_geometryShader("./shaders/shader.vert", "./shaders/gbuffer.frag"),
+	m_lightShader("./shaders/deferredlight.vert", "./shaders/deferredlight.frag"),
+	m_compositeShader("./shaders/deferredcomposite.vert", "./shaders/deferredcomposite.frag"),
+	m_volumeUniform(m_lightShader.GetUniform("volume"))
+{
+	configGeometry(m_geometryShader);
+	configLights(m_lightShader);
+	configComposite(m_compositeShader);
+
+	glGenBuffers(1, &m_instanceBuffer);
+	// one triangle covering the screen, in clip space
+	createVolume(m_fullScreen, { -1.0f, -1.0f, 0.0f, 3.0f, -1.0f, 0.0f, -1.0f, 3.0f, 0.0f });
+	createVolume(m_sphere, BuildSphere());
+	createVolume(m_cone, BuildCone());
+
+	// the composite covers the screen with the same triangle, without the light instances
+	glGenVertexArrays(1, &m_screenVao);
+	GLState::Get().BindVertexArray(m_screenVao);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_fullScreen.vbo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	GLState::Get().BindVertexArray(0);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+	deleteTargets();
+	for (Volume* volume : { &m_fullScreen, &m_sphere, &m_cone })
+	{
+		GLState::Get().DeleteVertexArrays(1, &volume->vao);
+		GLState::Get().DeleteBuffers(1, &volume->vbo);
+	}
+	GLState::Get().DeleteVertexArrays(1, &m_screenVao);
+	GLState::Get().DeleteBuffers(1, &m_instanceBuffer);
+}
+
+void DeferredRenderer::configGeometry(Shader& shader)
+{
+	shader.use();
+	shader.setInt("material.diffuse", 0);
+	shader.setInt("material.specular", 1);
+}
+
+void DeferredRenderer::configLights(Shader& shader)
+{
+	shader.use();
+	shader.setInt("gAlbedoSpec", ALBEDO_UNIT);
+	shader.setInt("gNormal", NORMAL_UNIT);
+	shader.setInt("gDepth", DEPTH_UNIT);
+	shader.setInt("lightData", LightManager::TEXTURE_UNIT);
+	shader.setFloat("material.shininess", 32.0f);
+}
+
+void DeferredRenderer::configComposite(Shader& shader)
+{
+	shader.use();
+	shader.setInt("gDepth", DEPTH_UNIT);
+	shader.setInt("lightBuffer", LIGHT_UNIT);
+}
+
+void DeferredRenderer::WatchShaders()
+{
+	HotReload::Get().WatchShader(m_geometryShader, configGeometry);
+	HotReload::Get().WatchShader(m_lightShader, configLights);
+	HotReload::Get().WatchShader(m_compositeShader, configComposite);
+}
+
+void DeferredRenderer::createVolume(Volume& volume, const vector<float>& positions)
+{
+	volume.vertexCount = (int)(positions.size() / 3);
+	glGenVertexArrays(1, &volume.vao);
+	glGenBuffers(1, &volume.vbo);
+	GLState::Get().BindVertexArray(volume.vao);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, volume.vbo);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	// the light slot, advancing once per instance
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	GLState::Get().BindVertexArray(0);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::drawVolume(const Volume& volume, size_t firstInstance, size_t count)
+{
+	if (count == 0)
+		return;
+
+	// no base instance before GL 4.2, the instance attribute starts at the volume's first light instead
+	GLState::Get().BindVertexArray(volume.vao);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glVertexAttribIPointer(1, 1, GL_INT, sizeof(uint32_t), (void*)(firstInstance * sizeof(uint32_t)));
+	glDrawArraysInstanced(GL_TRIANGLES, 0, volume.vertexCount, (GLsizei)count);
+}
+
+void DeferredRenderer::createTargets(int width, int height)
+{
+	deleteTargets();
+	m_width = width;
+	m_height = height;
+
+	auto createTexture = [width, height](unsigned int& texture, GLenum internalFormat, GLenum format, GLenum type)
+	{
+		glGenTextures(1, &texture);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	};
+	createTexture(m_albedoSpec, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+	createTexture(m_normal, GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_BYTE);
+	createTexture(m_depth, GL_R32F, GL_RED, GL_FLOAT);
+	createTexture(m_light, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthStencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// the light pass gets a framebuffer of its own, so the G-buffer it reads is never attached while it draws.
+	// Both share the depth/stencil buffer the volumes are tested against.
+	glGenFramebuffers(1, &m_geometryFramebuffer);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, m_geometryFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoSpec, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normal, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_depth, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+	const GLenum attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers(3, attachments);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::DEFERRED_RENDERER::GEOMETRY_FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+	glGenFramebuffers(1, &m_lightFramebuffer);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, m_lightFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_light, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::DEFERRED_RENDERER::LIGHT_FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::deleteTargets()
+{
+	GLState::Get().DeleteFramebuffers(1, &m_geometryFramebuffer);
+	GLState::Get().DeleteFramebuffers(1, &m_lightFramebuffer);
+	GLState::Get().DeleteTextures(1, &m_albedoSpec);
+	GLState::Get().DeleteTextures(1, &m_normal);
+	GLState::Get().DeleteTextures(1, &m_depth);
+	GLState::Get().DeleteTextures(1, &m_light);
+	glDeleteRenderbuffers(1, &m_depthStencil);
+	m_geometryFramebuffer = m_lightFramebuffer = m_albedoSpec = m_normal = m_depth = m_light = m_depthStencil = 0;
+}
+
+void DeferredRenderer::BeginGeometry(int width, int height)
+{
+	if (width != m_width || height != m_height)
+		createTargets(width, height);
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, m_geometryFramebuffer);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClearStencil(0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	// every pixel the scene covers gets stencil 1
+	GLState::Get().Enable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, 1, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	glStencilMask(0xFF);
+
+	m_geometryShader.use();
+}
+
+void DeferredRenderer::Shade()
+{
+	ProfileScope scope("frame", "deferred lighting");
+
+	// sort the lights into the volume they are drawn with
+	const vector<Light*>& lights = LightManager::Get().GetLights();
+	vector<uint32_t> spheres, cones;
+	m_instances.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = *lights[i];
+		float range = light.GetRange();
+		if (range <= 0.0f)
+			continue;
+		if (light.GetType() == LightType::Directional || range == FLT_MAX)
+			m_instances.push_back((uint32_t)i);
+		else if (light.GetType() == LightType::Spot && light.GetCosOuter() >= MIN_CONE_COS)
+			cones.push_back((uint32_t)i);
+		else
+			spheres.push_back((uint32_t)i);
+	}
+	m_fullScreenCount = m_instances.size();
+	m_sphereCount = spheres.size();
+	m_coneCount = cones.size();
+	m_instances.insert(m_instances.end(), spheres.begin(), spheres.end());
+	m_instances.insert(m_instances.end(), cones.begin(), cones.end());
+
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(uint32_t), m_instances.data(), GL_STREAM_DRAW);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// ----- LIGHT PASS -----
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, m_lightFramebuffer);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	GLState::Get().BindTextureUnit(ALBEDO_UNIT, GL_TEXTURE_2D, m_albedoSpec);
+	GLState::Get().BindTextureUnit(NORMAL_UNIT, GL_TEXTURE_2D, m_normal);
+	GLState::Get().BindTextureUnit(DEPTH_UNIT, GL_TEXTURE_2D, m_depth);
+
+	// lights add up, only where the scene drew something
+	GLState::Get().Enable(GL_BLEND);
+	GLState::Get().BlendFunc(GL_ONE, GL_ONE);
+	glStencilFunc(GL_EQUAL, 1, 0xFF);
+	glStencilMask(0x00);
+	GLState::Get().DepthMask(GL_FALSE);
+
+	m_lightShader.use();
+	m_lightShader.setInt(m_volumeUniform, 0);
+	GLState::Get().Disable(GL_DEPTH_TEST);
+	drawVolume(m_fullScreen, 0, m_fullScreenCount);
+
+	// the back faces of a volume behind the surface. Clamping keeps the parts beyond the far plane, and the camera
+	// inside a volume needs no special case.
+	GLState::Get().Enable(GL_DEPTH_TEST);
+	GLState::Get().DepthFunc(GL_GEQUAL);
+	GLState::Get().Enable(GL_DEPTH_CLAMP);
+	GLState::Get().Enable(GL_CULL_FACE);
+	GLState::Get().CullFace(GL_FRONT);
+	m_lightShader.setInt(m_volumeUniform, 1);
+	drawVolume(m_sphere, m_fullScreenCount, m_sphereCount);
+	m_lightShader.setInt(m_volumeUniform, 2);
+	drawVolume(m_cone, m_fullScreenCount + m_sphereCount, m_coneCount);
+
+	GLState::Get().Disable(GL_CULL_FACE);
+	GLState::Get().CullFace(GL_BACK);
+	GLState::Get().Disable(GL_DEPTH_CLAMP);
+	GLState::Get().Disable(GL_BLEND);
+	GLState::Get().Disable(GL_STENCIL_TEST);
+	glStencilMask(0xFF);
+
+	// ----- COMPOSITE -----
+
+	// onto whatever is in the default framebuffer already (the sky), with the scene's depth for later passes
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::Get().BindTextureUnit(LIGHT_UNIT, GL_TEXTURE_2D, m_light);
+	GLState::Get().DepthMask(GL_TRUE);
+	GLState::Get().DepthFunc(GL_ALWAYS);
+	m_compositeShader.use();
+	GLState::Get().BindVertexArray(m_screenVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	GLState::Get().DepthFunc(GL_LESS);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Deferred shading, the alternative to the forward lighting shader picked at startup with --deferred.
+//
+// The geometry pass draws the scene once with GetGeometryShader() into the G-buffer:
+//   gAlbedoSpec	RGBA8		diffuse colour, specular intensity in alpha
+//   gNormal		RGB10_A2	world space normal * 0.5 + 0.5
+//   gDepth		R32F		view space depth, 0 where nothing was drawn
+// plus a depth/stencil buffer whose stencil marks the covered pixels.
+//
+// Shade then adds up every light of the LightManager in a light buffer: directional lights (and lights without a
+// range) as full screen triangles, point lights as spheres and spot lights as cones around their range, each kind
+// in one instanced draw. Volumes draw their back faces where they lie behind the surface (depth test GEQUAL), so
+// only pixels in front of the volume's far side are shaded, and the stencil skips pixels without geometry. The
+// result is written to the default framebuffer together with the scene's depth.
+class DeferredRenderer
+{
+public:
+	// set by --deferred, read once at startup
+	static bool enabled;
+
+	// texture units the G-buffer is read from by the light and composite passes
+	static const unsigned int ALBEDO_UNIT = 0;
+	static const unsigned int NORMAL_UNIT = 1;
+	static const unsigned int DEPTH_UNIT = 2;
+	static const unsigned int LIGHT_UNIT = 3;
+
+	// GL thread, compiles the shaders and builds the light volumes. The G-buffer is created by the first frame.
+	DeferredRenderer();
+	~DeferredRenderer();
+
+	DeferredRenderer(const DeferredRenderer&) = delete;
+	DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+	// what the scene's MeshRenderers draw with when deferred shading is on
+	Shader& GetGeometryShader() { return m_geometryShader; }
+
+	// recompiles the deferred shaders when their sources change
+	void WatchShaders();
+
+	// binds the G-buffer, resized to the viewport if needed, and clears it. The scene is drawn after this.
+	void BeginGeometry(int width, int height);
+	// after the scene and LightManager::Update: lights the G-buffer and writes the result to the default framebuffer
+	void Shade();
+
+	// lights drawn by the last Shade, per volume kind
+	size_t GetFullScreenCount() const { return m_fullScreenCount; }
+	size_t GetSphereCount() const { return m_sphereCount; }
+	size_t GetConeCount() const { return m_coneCount; }
+
+private:
+	// a mesh the light instances are drawn with
+	struct Volume {
+		unsigned int vao = 0;
+		unsigned int vbo = 0;
+		int vertexCount = 0;
+	};
+
+	static void configGeometry(Shader& shader);
+	static void configLights(Shader& shader);
+	static void configComposite(Shader& shader);
+
+	void createVolume(Volume& volume, const vector<float>& positions);
+	void drawVolume(const Volume& volume, size_t firstInstance, size_t count);
+	void createTargets(int width, int height);
+	void deleteTargets();
+
+	Shader m_geometryShader;
+	Shader m_lightShader;
+	Shader m_compositeShader;
+	Shader::Uniform m_volumeUniform;
+
+	Volume m_fullScreen;
+	Volume m_sphere;
+	Volume m_cone;
+	unsigned int m_screenVao = 0;
+	unsigned int m_instanceBuffer = 0;	// light slots, full screen lights first, then spheres, then cones
+	vector<uint32_t> m_instances;
+	size_t m_fullScreenCount = 0;
+	size_t m_sphereCount = 0;
+	size_t m_coneCount = 0;
+
+	int m_width = 0;
+	int m_height = 0;
+	unsigned int m_geometryFramebuffer = 0;
+	unsigned int m_lightFramebuffer = 0;
+	unsigned int m_albedoSpec = 0;
+	unsigned int m_normal = 0;
+	unsigned int m_depth = 0;
+	unsigned int m_light = 0;
+	unsigned int m_depthStencil = 0;
+};
@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 
+#include "GLState.h"
+
 class Display
 {
 public:
@@ -96,6 +98,9 @@ Display::Display(int width, int height, const char* title) : m_width(width), m_h
 		std::cout << "Failed to initialize GLAD" << std::endl;
 	}
 
+	// whatever GLState remembers belongs to an earlier context, if any, so every state is sent once again
+	GLState::Get().Invalidate();
+
 	glfwSetWindowUserPointer(m_window, (void*)this);
 }
 
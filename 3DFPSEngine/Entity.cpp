@@ -4,13 +4,15 @@
 #include <glm/gtc/type_ptr.hpp>
 
 
-Entity::Entity(const char* model_path, Shader& shader, Camera& camera) : m_model(model_path), m_shader(shader), m_camera(camera) {}
+Entity::Entity(const char* model_path, Shader& shader, Camera& camera) : m_model(model_path), m_shader(shader), m_camera(camera)
+{
+	m_model_uniform = m_shader.GetUniform("model");
+}
 
 void Entity::Render()
 {
-	m_shader.setMat4("projection", m_camera.GetProjectionMatrix());
-	m_shader.setMat4("view", m_camera.GetViewMatrix());
-	m_shader.setMat4("model", m_model_matrix);
+	// view and projection come from the camera uniform buffer, Camera::CopyVectors fills it
+	m_shader.setMat4(m_model_uniform, m_model_matrix);
 	m_model.Draw(m_shader);
 }
 
@@ -34,5 +34,6 @@ private:
 	glm::vec3 m_scale;
 	glm::vec3 m_euler_rotation;
 	glm::quat m_quat_rotation;
+	Shader::Uniform m_model_uniform;
 };
 
@@ -0,0 +1,187 @@
+#include "FileSystem.h"
+
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+static void ListFiles(const std::string& directory, std::vector<std::string>& files, std::vector<std::string>* directories = nullptr)
+{
+	if (directories)
+		directories->push_back(directory);
+
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA((directory + "/*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		std::string name = entry.cFileName;
+		if (name == "." || name == "..")
+			continue;
+
+		std::string path = directory + "/" + name;
+		if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			ListFiles(path, files, directories);
+		else
+			files.push_back(path);
+	} while (FindNextFileA(find, &entry));
+
+	FindClose(find);
+}
+
+bool MakeDirectory(const std::string& directory)
+{
+	return CreateDirectoryA(directory.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+bool GetModificationTime(const std::string& path, int64_t& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+		return false;
+	time = ((int64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+bool GetFileSize(const std::string& path, uint64_t& size)
+{
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+		return false;
+	size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	return true;
+}
+
+#else
+
+static void ListFiles(const std::string& directory, std::vector<std::string>& files, std::vector<std::string>* directories = nullptr)
+{
+	if (directories)
+		directories->push_back(directory);
+
+	DIR* dir = opendir(directory.c_str());
+	if (!dir)
+		return;
+
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		std::string path = directory + "/" + name;
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			continue;
+		if (S_ISDIR(info.st_mode))
+			ListFiles(path, files, directories);
+		else if (S_ISREG(info.st_mode))
+			files.push_back(path);
+	}
+
+	closedir(dir);
+}
+
+bool MakeDirectory(const std::string& directory)
+{
+	return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool GetModificationTime(const std::string& path, int64_t& time)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+#ifdef __APPLE__
+	time = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	time = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool GetFileSize(const std::string& path, uint64_t& size)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	size = (uint64_t)info.st_size;
+	return true;
+}
+
+#endif
+
+std::vector<std::string> ListFiles(const std::string& directory)
+{
+	std::vector<std::string> files;
+	ListFiles(directory, files);
+	// directory order differs between platforms, keep the result stable
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+std::vector<std::string> ListDirectories(const std::string& directory)
+{
+	std::vector<std::string> files, directories;
+	ListFiles(directory, files, &directories);
+	std::sort(directories.begin(), directories.end());
+	return directories;
+}
+
+std::string CanonicalPath(const std::string& path)
+{
+	std::string normalised = path;
+	std::replace(normalised.begin(), normalised.end(), '\\', '/');
+#ifdef _WIN32
+	// paths are case insensitive on windows
+	std::transform(normalised.begin(), normalised.end(), normalised.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start <= normalised.size())
+	{
+		size_t end = normalised.find('/', start);
+		if (end == std::string::npos)
+			end = normalised.size();
+		std::string segment = normalised.substr(start, end - start);
+		if (segment == ".." && !segments.empty() && segments.back() != "..")
+			segments.pop_back();
+		else if (!segment.empty() && segment != ".")
+			segments.push_back(segment);
+		start = end + 1;
+	}
+
+	std::string canonical = !normalised.empty() && normalised[0] == '/' ? "/" : "";
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0)
+			canonical += '/';
+		canonical += segments[i];
+	}
+	return canonical;
+}
+
+std::string GetExtension(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return std::string();
+
+	std::string extension = path.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small portable file system helpers, paths use forward slashes throughout.
+
+// every regular file below the directory, recursively, as directory + "/" + relative path
+std::vector<std::string> ListFiles(const std::string& directory);
+
+// the directory itself and every directory below it, recursively
+std::vector<std::string> ListDirectories(const std::string& directory);
+
+// last write time of a file in an unspecified but consistent unit, false if it doesn't exist
+bool GetModificationTime(const std::string& path, int64_t& time);
+
+// size of a file in bytes, false if it doesn't exist
+bool GetFileSize(const std::string& path, uint64_t& size);
+
+// creates the directory if it doesn't exist yet (the parent must exist), false on failure
+bool MakeDirectory(const std::string& directory);
+
+// normalises separators and "." / ".." segments so different spellings of a path compare equal
+std::string CanonicalPath(const std::string& path);
+
+// the extension including the dot and lowercased, empty if there is none
+std::string GetExtension(const std::string& path);
@@ -0,0 +1,144 @@
+#include "FileWatcher.h"
+#include "FileSystem.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher()
+{
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_fd < 0)
+		std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (m_fd >= 0)
+		close(m_fd);
+}
+
+void FileWatcher::addWatch(const std::string& directory)
+{
+	// close-write and moved-to fire once a file is complete, editors that save by renaming a temporary
+	// file over the original only produce the latter
+	int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0)
+	{
+		std::cout << "ERROR::FILE_WATCHER::COULD_NOT_WATCH " << directory << std::endl;
+		return;
+	}
+	m_directories[wd] = directory;
+}
+
+bool FileWatcher::WatchDirectory(const std::string& directory)
+{
+	if (m_fd < 0)
+		return false;
+
+	std::vector<std::string> directories = ListDirectories(directory);
+	for (const std::string& dir : directories)
+		addWatch(dir);
+	return !directories.empty();
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changed;
+	if (m_fd < 0)
+		return changed;
+
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t length = read(m_fd, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;	// EAGAIN, everything has been read
+
+		for (char* cursor = buffer; cursor < buffer + length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+
+			auto directory = m_directories.find(event->wd);
+			if (directory == m_directories.end() || event->len == 0)
+				continue;
+
+			std::string path = directory->second + "/" + event->name;
+			if (event->mask & IN_ISDIR)
+			{
+				// new subdirectory, files in it are reported from now on
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					for (const std::string& dir : ListDirectories(path))
+						addWatch(dir);
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				changed.push_back(path);
+		}
+	}
+
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {}
+
+bool FileWatcher::WatchDirectory(const std::string& directory)
+{
+	if (ListDirectories(directory).empty())
+		return false;
+
+	m_roots.push_back(directory);
+	// remember the current state so only later writes are reported
+	for (const std::string& file : ListFiles(directory))
+	{
+		int64_t time;
+		if (GetModificationTime(file, time))
+			m_times[file] = time;
+	}
+	return true;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changed;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now < m_nextScan)
+		return changed;
+	m_nextScan = now + std::chrono::milliseconds(POLL_INTERVAL_MS);
+
+	for (const std::string& root : m_roots)
+	{
+		for (const std::string& file : ListFiles(root))
+		{
+			int64_t time;
+			if (!GetModificationTime(file, time))
+				continue;
+
+			auto known = m_times.find(file);
+			if (known == m_times.end() || known->second != time)
+			{
+				m_times[file] = time;
+				changed.push_back(file);
+			}
+		}
+	}
+
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	return changed;
+}
+
+#endif
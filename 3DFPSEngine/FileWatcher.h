@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files that were written below a set of watched directories. Uses inotify on Linux, elsewhere the
+// directories are rescanned for changed modification times every POLL_INTERVAL. Meant to be polled once a
+// frame from one thread.
+class FileWatcher
+{
+public:
+	static const int POLL_INTERVAL_MS = 500;
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// watches the directory and everything below it, directories created later are watched as well
+	bool WatchDirectory(const std::string& directory);
+
+	// files that finished being written since the last call, each listed once, never blocks
+	std::vector<std::string> Poll();
+
+private:
+#ifdef __linux__
+	void addWatch(const std::string& directory);
+
+	int m_fd = -1;
+	std::unordered_map<int, std::string> m_directories;	// watch descriptor -> directory
+#else
+	std::vector<std::string> m_roots;
+	std::unordered_map<std::string, int64_t> m_times;	// last seen modification time per file
+	std::chrono::steady_clock::time_point m_nextScan;
+#endif
+};
@@ -0,0 +1,329 @@
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// std::fill takes UNKNOWN by reference, so it needs a definition
+const GLuint GLState::UNKNOWN;
+
+bool GLState::enabled = true;
+unsigned int GLState::reportInterval = 0;
+
+GLState& GLState::Get()
+{
+	static GLState state;
+	return state;
+}
+
+// a fresh context's defaults
+GLState::GLState()
+{
+	m_program = 0;
+	m_activeUnit = 0;
+	std::fill(&m_textures[0][0], &m_textures[0][0] + TEXTURE_UNITS * TEXTURE_TARGETS, 0u);
+	m_vao = 0;
+	std::fill(m_buffers, m_buffers + BUFFER_TARGETS, 0u);
+	std::fill(m_uniformBindings, m_uniformBindings + UNIFORM_BINDINGS, 0u);
+	m_framebuffer = 0;
+	std::fill(m_capabilities, m_capabilities + CAPABILITIES, 0u);
+	m_capabilities[capability(GL_MULTISAMPLE)] = 1;
+	m_depthMask = GL_TRUE;
+	m_depthFunc = GL_LESS;
+	m_blendSource = GL_ONE;
+	m_blendDestination = GL_ZERO;
+	m_cullFace = GL_BACK;
+}
+
+const char* GLState::GetCallName(Call call)
+{
+	static const char* const NAMES[CALL_COUNT] = { "UseProgram", "ActiveTexture", "BindTexture", "BindVertexArray", "BindBuffer",
+		"BindFramebuffer", "Enable/Disable", "DepthMask", "DepthFunc", "BlendFunc", "CullFace" };
+	return NAMES[call];
+}
+
+int GLState::textureTarget(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D:
+		return 0;
+	case GL_TEXTURE_CUBE_MAP:
+		return 1;
+	case GL_TEXTURE_BUFFER:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+int GLState::bufferTarget(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER:
+		return 0;
+	case GL_UNIFORM_BUFFER:
+		return 1;
+	case GL_TEXTURE_BUFFER:
+		return 2;
+	case GL_COPY_READ_BUFFER:
+		return 3;
+	case GL_COPY_WRITE_BUFFER:
+		return 4;
+	default:
+		return -1;
+	}
+}
+
+int GLState::capability(GLenum capability)
+{
+	switch (capability)
+	{
+	case GL_DEPTH_TEST:
+		return 0;
+	case GL_BLEND:
+		return 1;
+	case GL_CULL_FACE:
+		return 2;
+	case GL_STENCIL_TEST:
+		return 3;
+	case GL_DEPTH_CLAMP:
+		return 4;
+	case GL_MULTISAMPLE:
+		return 5;
+	default:
+		return -1;
+	}
+}
+
+bool GLState::elide(Call call, bool unchanged)
+{
+	if (enabled && unchanged)
+	{
+		m_counters.elided[call]++;
+		return true;
+	}
+	m_counters.issued[call]++;
+	return false;
+}
+
+void GLState::UseProgram(GLuint program)
+{
+	if (elide(USE_PROGRAM, m_program == program))
+		return;
+	m_program = program;
+	glUseProgram(program);
+}
+
+void GLState::ActiveTexture(GLenum unit)
+{
+	if (elide(ACTIVE_TEXTURE, m_activeUnit == unit - GL_TEXTURE0))
+		return;
+	m_activeUnit = unit - GL_TEXTURE0;
+	glActiveTexture(unit);
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	int t = textureTarget(target);
+	bool cached = t >= 0 && m_activeUnit < TEXTURE_UNITS;
+	if (elide(BIND_TEXTURE, cached && m_textures[m_activeUnit][t] == texture))
+		return;
+	if (cached)
+		m_textures[m_activeUnit][t] = texture;
+	glBindTexture(target, texture);
+}
+
+void GLState::BindTextureUnit(GLuint unit, GLenum target, GLuint texture)
+{
+	int t = textureTarget(target);
+	if (enabled && t >= 0 && unit < TEXTURE_UNITS && m_textures[unit][t] == texture)
+	{
+		m_counters.elided[BIND_TEXTURE]++;
+		return;
+	}
+	ActiveTexture(GL_TEXTURE0 + unit);
+	BindTexture(target, texture);
+}
+
+void GLState::BindVertexArray(GLuint vao)
+{
+	if (elide(BIND_VERTEX_ARRAY, m_vao == vao))
+		return;
+	m_vao = vao;
+	glBindVertexArray(vao);
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	int b = bufferTarget(target);
+	if (elide(BIND_BUFFER, b >= 0 && m_buffers[b] == buffer))
+		return;
+	if (b >= 0)
+		m_buffers[b] = buffer;
+	glBindBuffer(target, buffer);
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	bool cached = target == GL_UNIFORM_BUFFER && index < UNIFORM_BINDINGS;
+	if (elide(BIND_BUFFER, cached && m_uniformBindings[index] == buffer && m_buffers[bufferTarget(target)] == buffer))
+		return;
+	if (cached)
+		m_uniformBindings[index] = buffer;
+	int b = bufferTarget(target);
+	if (b >= 0)
+		m_buffers[b] = buffer;
+	glBindBufferBase(target, index, buffer);
+}
+
+void GLState::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	// only the combined target is tracked, binding just the draw or the read side makes the copy unknown
+	if (elide(BIND_FRAMEBUFFER, target == GL_FRAMEBUFFER && m_framebuffer == framebuffer))
+		return;
+	m_framebuffer = target == GL_FRAMEBUFFER ? framebuffer : UNKNOWN;
+	glBindFramebuffer(target, framebuffer);
+}
+
+void GLState::setCapability(GLenum capability, bool on)
+{
+	int c = GLState::capability(capability);
+	if (elide(CAPABILITY, c >= 0 && m_capabilities[c] == (on ? 1u : 0u)))
+		return;
+	if (c >= 0)
+		m_capabilities[c] = on ? 1 : 0;
+	if (on)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLState::Enable(GLenum capability)
+{
+	setCapability(capability, true);
+}
+
+void GLState::Disable(GLenum capability)
+{
+	setCapability(capability, false);
+}
+
+void GLState::DepthMask(GLboolean flag)
+{
+	if (elide(DEPTH_MASK, m_depthMask == flag))
+		return;
+	m_depthMask = flag;
+	glDepthMask(flag);
+}
+
+void GLState::DepthFunc(GLenum func)
+{
+	if (elide(DEPTH_FUNC, m_depthFunc == func))
+		return;
+	m_depthFunc = func;
+	glDepthFunc(func);
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination)
+{
+	if (elide(BLEND_FUNC, m_blendSource == source && m_blendDestination == destination))
+		return;
+	m_blendSource = source;
+	m_blendDestination = destination;
+	glBlendFunc(source, destination);
+}
+
+void GLState::CullFace(GLenum mode)
+{
+	if (elide(CULL_FACE, m_cullFace == mode))
+		return;
+	m_cullFace = mode;
+	glCullFace(mode);
+}
+
+void GLState::DeleteProgram(GLuint program)
+{
+	// a program in use stays current until another one is, but the next UseProgram must not be skipped
+	if (m_program == program)
+		m_program = UNKNOWN;
+	glDeleteProgram(program);
+}
+
+void GLState::DeleteTextures(GLsizei count, const GLuint* textures)
+{
+	for (GLsizei i = 0; i < count; i++)
+		for (int u = 0; u < TEXTURE_UNITS; u++)
+			for (int t = 0; t < TEXTURE_TARGETS; t++)
+				if (textures[i] != 0 && m_textures[u][t] == textures[i])
+					m_textures[u][t] = 0;
+	glDeleteTextures(count, textures);
+}
+
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vaos)
+{
+	for (GLsizei i = 0; i < count; i++)
+		if (vaos[i] != 0 && m_vao == vaos[i])
+			m_vao = 0;
+	glDeleteVertexArrays(count, vaos);
+}
+
+void GLState::DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		if (buffers[i] == 0)
+			continue;
+		for (int b = 0; b < BUFFER_TARGETS; b++)
+			if (m_buffers[b] == buffers[i])
+				m_buffers[b] = 0;
+		for (int b = 0; b < UNIFORM_BINDINGS; b++)
+			if (m_uniformBindings[b] == buffers[i])
+				m_uniformBindings[b] = 0;
+	}
+	glDeleteBuffers(count, buffers);
+}
+
+void GLState::DeleteFramebuffers(GLsizei count, const GLuint* framebuffers)
+{
+	for (GLsizei i = 0; i < count; i++)
+		if (framebuffers[i] != 0 && m_framebuffer == framebuffers[i])
+			m_framebuffer = 0;
+	glDeleteFramebuffers(count, framebuffers);
+}
+
+void GLState::Invalidate()
+{
+	m_program = UNKNOWN;
+	m_activeUnit = UNKNOWN;
+	std::fill(&m_textures[0][0], &m_textures[0][0] + TEXTURE_UNITS * TEXTURE_TARGETS, UNKNOWN);
+	m_vao = UNKNOWN;
+	std::fill(m_buffers, m_buffers + BUFFER_TARGETS, UNKNOWN);
+	std::fill(m_uniformBindings, m_uniformBindings + UNIFORM_BINDINGS, UNKNOWN);
+	m_framebuffer = UNKNOWN;
+	std::fill(m_capabilities, m_capabilities + CAPABILITIES, UNKNOWN);
+	m_depthMask = UNKNOWN;
+	m_depthFunc = UNKNOWN;
+	m_blendSource = m_blendDestination = UNKNOWN;
+	m_cullFace = UNKNOWN;
+}
+
+void GLState::EndFrame()
+{
+	m_frame = m_counters;
+	m_counters = Counters();
+	m_frameNumber++;
+
+	if (reportInterval == 0 || m_frameNumber % reportInterval != 0)
+		return;
+	size_t issued = 0, elided = 0;
+	for (int c = 0; c < CALL_COUNT; c++)
+	{
+		issued += m_frame.issued[c];
+		elided += m_frame.elided[c];
+	}
+	printf("GL state, frame %u: %zu calls issued, %zu elided\n", m_frameNumber, issued, elided);
+	for (int c = 0; c < CALL_COUNT; c++)
+		if (m_frame.issued[c] + m_frame.elided[c] > 0)
+			printf("  %-16s %6zu issued %6zu elided\n", GetCallName((Call)c), m_frame.issued[c], m_frame.elided[c]);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Shadow copy of the GL state the renderer changes most: the program, texture bindings per unit, the VAO, buffer
+// bindings, the framebuffer and a few fixed function switches. A call that would set what is already set is
+// skipped. Everything that binds, enables or deletes these objects has to go through here, or the copy goes stale.
+// The element array binding is part of the VAO and is always passed on. GL thread only.
+class GLState
+{
+public:
+	// off: every call goes to GL (the copy is still kept), for comparison
+	static bool enabled;
+	// print the counts of the last frame every this many frames, 0 for never. main sets it with --gl-stats.
+	static unsigned int reportInterval;
+
+	enum Call {
+		USE_PROGRAM,
+		ACTIVE_TEXTURE,
+		BIND_TEXTURE,
+		BIND_VERTEX_ARRAY,
+		BIND_BUFFER,
+		BIND_FRAMEBUFFER,
+		CAPABILITY,		// Enable and Disable
+		DEPTH_MASK,
+		DEPTH_FUNC,
+		BLEND_FUNC,
+		CULL_FACE,
+		CALL_COUNT
+	};
+
+	// calls passed on to GL and calls skipped, per kind
+	struct Counters {
+		size_t issued[CALL_COUNT] = {};
+		size_t elided[CALL_COUNT] = {};
+	};
+
+	static GLState& Get();
+	static const char* GetCallName(Call call);
+
+	void UseProgram(GLuint program);
+	void ActiveTexture(GLenum unit);
+	// binds to the active unit
+	void BindTexture(GLenum target, GLuint texture);
+	// binds to the given unit (0 based), making it the active unit only if the binding changes
+	void BindTextureUnit(GLuint unit, GLenum target, GLuint texture);
+	void BindVertexArray(GLuint vao);
+	void BindBuffer(GLenum target, GLuint buffer);
+	// also binds the buffer to the target's generic binding point, like GL does
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void BindFramebuffer(GLenum target, GLuint framebuffer);
+	void Enable(GLenum capability);
+	void Disable(GLenum capability);
+	void DepthMask(GLboolean flag);
+	void DepthFunc(GLenum func);
+	void BlendFunc(GLenum source, GLenum destination);
+	void CullFace(GLenum mode);
+
+	// GL resets the bindings of deleted objects to 0, the copy has to follow
+	void DeleteProgram(GLuint program);
+	void DeleteTextures(GLsizei count, const GLuint* textures);
+	void DeleteVertexArrays(GLsizei count, const GLuint* vaos);
+	void DeleteBuffers(GLsizei count, const GLuint* buffers);
+	void DeleteFramebuffers(GLsizei count, const GLuint* framebuffers);
+
+	// forgets the copy, after code that changed the state directly
+	void Invalidate();
+
+	// once per frame after the swap: keeps the counts of the frame that ended and starts new ones
+	void EndFrame();
+	const Counters& GetFrameCounters() const { return m_frame; }
+
+private:
+	GLState();
+	GLState(const GLState&) = delete;
+	GLState& operator=(const GLState&) = delete;
+
+	static const GLuint UNKNOWN = ~0u;
+	static const int TEXTURE_UNITS = 16;
+	static const int TEXTURE_TARGETS = 3;	// 2D, cubemap, buffer
+	static const int BUFFER_TARGETS = 5;	// array, uniform, texture, copy read, copy write
+	static const int UNIFORM_BINDINGS = 16;
+	static const int CAPABILITIES = 6;		// depth test, blend, cull face, stencil test, depth clamp, multisample
+
+	static int textureTarget(GLenum target);
+	static int bufferTarget(GLenum target);
+	static int capability(GLenum capability);
+
+	// true if the call can be skipped, counts it either way
+	bool elide(Call call, bool unchanged);
+	void setCapability(GLenum capability, bool on);
+
+	GLuint m_program;
+	GLuint m_activeUnit;
+	GLuint m_textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint m_vao;
+	GLuint m_buffers[BUFFER_TARGETS];
+	GLuint m_uniformBindings[UNIFORM_BINDINGS];
+	GLuint m_framebuffer;
+	GLuint m_capabilities[CAPABILITIES];	// 0, 1 or UNKNOWN
+	GLuint m_depthMask;
+	GLenum m_depthFunc;
+	GLenum m_blendSource;
+	GLenum m_blendDestination;
+	GLenum m_cullFace;
+
+	Counters m_counters;	// of the frame in progress
+	Counters m_frame;		// of the last finished frame
+	unsigned int m_frameNumber = 0;
+};
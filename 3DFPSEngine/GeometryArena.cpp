@@ -0,0 +1,185 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <map>
+
+GeometryArena::GeometryArena(VertexFormat format) : m_format(format), m_stride(GetVertexSize(format))
+{
+	glGenVertexArrays(1, &m_vao);
+}
+
+GeometryArena::~GeometryArena()
+{
+	if (m_vao)
+		GLState::Get().DeleteVertexArrays(1, &m_vao);
+	if (m_vbo)
+		GLState::Get().DeleteBuffers(1, &m_vbo);
+	if (m_ebo)
+		GLState::Get().DeleteBuffers(1, &m_ebo);
+}
+
+std::shared_ptr<GeometryArena> GeometryArena::GetShared(VertexFormat format)
+{
+	static std::map<VertexFormat, std::shared_ptr<GeometryArena>> arenas;
+	std::shared_ptr<GeometryArena>& arena = arenas[format];
+	if (!arena)
+		arena = std::make_shared<GeometryArena>(format);
+	return arena;
+}
+
+// replaces buffer with a bigger one holding the first used bytes of the old contents
+static unsigned int GrowBuffer(unsigned int buffer, size_t used, size_t capacity)
+{
+	unsigned int grown;
+	glGenBuffers(1, &grown);
+	GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+	if (buffer)
+	{
+		if (used > 0)
+		{
+			GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+			GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		GLState::Get().DeleteBuffers(1, &buffer);
+	}
+	GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return grown;
+}
+
+void GeometryArena::Reserve(size_t vertices, size_t indexBytes)
+{
+	indexBytes = AlignIndexBytes(indexBytes);
+	bool vertexGrowth = vertices > m_vertexCapacity;
+	bool indexGrowth = indexBytes > m_indexCapacity;
+	if (!vertexGrowth && !indexGrowth)
+		return;
+
+	// grow geometrically once something has been allocated so repeated uploads don't copy every time
+	if (vertexGrowth)
+	{
+		m_vertexCapacity = m_vertexCount ? std::max(vertices, m_vertexCapacity * 2) : vertices;
+		m_vbo = GrowBuffer(m_vbo, m_vertexCount * m_stride, m_vertexCapacity * m_stride);
+	}
+	if (indexGrowth)
+	{
+		m_indexCapacity = m_indexBytes ? std::max(indexBytes, m_indexCapacity * 2) : indexBytes;
+		m_ebo = GrowBuffer(m_ebo, m_indexBytes, m_indexCapacity);
+	}
+
+	// the VAO captured the old buffers, point it at the new ones
+	setupAttributes();
+}
+
+GeometryArena::Range GeometryArena::Upload(const void* vertexData, unsigned int numVertices, const void* indexData, size_t indexBytes)
+{
+	Reserve(m_vertexCount + numVertices, m_indexBytes + indexBytes);
+
+	Range range;
+	range.baseVertex = (unsigned int)m_vertexCount;
+	if (numVertices > 0)
+	{
+		GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, m_vertexCount * m_stride, numVertices * m_stride, vertexData);
+		GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	m_vertexCount += numVertices;
+
+	range.indexOffset = UploadIndices(indexData, indexBytes);
+	return range;
+}
+
+size_t GeometryArena::UploadIndices(const void* indexData, size_t indexBytes)
+{
+	Reserve(m_vertexCount, m_indexBytes + indexBytes);
+
+	size_t offset = m_indexBytes;
+	if (indexBytes > 0)
+	{
+		// upload through the arena's own VAO so whatever VAO is bound elsewhere keeps its element buffer
+		GLState::Get().BindVertexArray(m_vao);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, indexBytes, indexData);
+		GLState::Get().BindVertexArray(0);
+	}
+	m_indexBytes = AlignIndexBytes(m_indexBytes + indexBytes);
+	return offset;
+}
+
+void GeometryArena::Bind() const
+{
+	GLState::Get().BindVertexArray(m_vao);
+}
+
+void GeometryArena::BindInstances(unsigned int buffer, size_t offset)
+{
+	GLState::Get().BindVertexArray(m_vao);
+	if (buffer == m_instanceBuffer && offset == m_instanceOffset)
+		return;
+
+	// the attributes stay enabled afterwards, draws without instances read the first matrix and ignore it
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLsizei stride = (GLsizei)(16 * sizeof(float));
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		GLuint location = INSTANCE_LOCATION + i;
+		if (!m_instanceBuffer)
+		{
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, 1);
+		}
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + i * 4 * sizeof(float)));
+	}
+	m_instanceBuffer = buffer;
+	m_instanceOffset = offset;
+}
+
+void GeometryArena::setupAttributes()
+{
+	GLState::Get().BindVertexArray(m_vao);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+	GLsizei stride = (GLsizei)m_stride;
+	if (!m_vbo)
+	{
+		// nothing to point the attributes at yet
+	}
+	else if (m_format == VertexFormat::Packed)
+	{
+		// vertex Positions, w holds the bitangent sign
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Position));
+		// vertex normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Normal));
+		// vertex texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, TexCoords));
+		// vertex tangent, the bitangent is reconstructed in the shader
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Tangent));
+	}
+	else
+	{
+		// vertex Positions
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		// vertex normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Normal));
+		// vertex texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, TexCoords));
+		// vertex tangent
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Tangent));
+		// vertex bitangent
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Bitangent));
+	}
+
+	GLState::Get().BindVertexArray(0);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <memory>
+
+// One vertex buffer, one index buffer and the VAO describing them, shared by many meshes of the same vertex format.
+// Meshes are suballocated with a bump allocator and drawn with glDrawElementsBaseVertex, so switching between them
+// needs no VAO change. Allocations are never freed individually, the buffers go away with the arena.
+class GeometryArena
+{
+public:
+	// where a mesh lives inside the arena
+	struct Range {
+		unsigned int baseVertex = 0;	// added to every index by glDrawElementsBaseVertex
+		size_t indexOffset = 0;			// in bytes, for the indices argument of the draw
+	};
+
+	explicit GeometryArena(VertexFormat format);
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// process wide arena for geometry that stays loaded, one per vertex format
+	static std::shared_ptr<GeometryArena> GetShared(VertexFormat format);
+
+	// makes room for at least this many vertices and index bytes in total, growing the buffers if needed.
+	// Existing ranges stay valid.
+	void Reserve(size_t vertices, size_t indexBytes);
+
+	// copies a mesh into the arena, growing it if it doesn't fit. GL thread only.
+	Range Upload(const void* vertexData, unsigned int numVertices, const void* indexData, size_t indexBytes);
+
+	// appends indices only, e.g. a LOD of a mesh already in the arena. Returns their byte offset.
+	size_t UploadIndices(const void* indexData, size_t indexBytes);
+
+	void Bind() const;
+
+	// locations 5 to 8 hold a per instance model matrix, one column each
+	static const unsigned int INSTANCE_LOCATION = 5;
+	// binds the VAO and points the instance matrix at the matrices starting offset bytes into buffer. GL 3.3 has
+	// no base instance, so each instanced draw whose matrices start elsewhere points them again.
+	void BindInstances(unsigned int buffer, size_t offset);
+	unsigned int GetVAO() const { return m_vao; }
+	VertexFormat GetFormat() const { return m_format; }
+	size_t GetVertexCount() const { return m_vertexCount; }
+	size_t GetIndexBytes() const { return m_indexBytes; }
+
+	// index ranges are 4 byte aligned so 16 and 32 bit meshes can share the buffer
+	static size_t AlignIndexBytes(size_t bytes) { return (bytes + 3) & ~(size_t)3; }
+
+private:
+	void setupAttributes();
+
+	VertexFormat m_format;
+	size_t m_stride;
+	unsigned int m_vao = 0;
+	unsigned int m_vbo = 0;
+	unsigned int m_ebo = 0;
+	size_t m_vertexCapacity = 0;
+	size_t m_vertexCount = 0;
+	size_t m_indexCapacity = 0;	// bytes
+	size_t m_indexBytes = 0;
+	unsigned int m_instanceBuffer = 0;	// what the instance attributes point at, 0 until the first instanced draw
+	size_t m_instanceOffset = 0;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit FNV-1a. Not cryptographic, only used to detect changed asset files and to key caches.
+const uint64_t HASH_SEED = 14695981039346656037ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,83 @@
+#include "HotReload.h"
+#include "AssetStreamer.h"
+#include "FileSystem.h"
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+HotReload& HotReload::Get()
+{
+	static HotReload reload;
+	return reload;
+}
+
+void HotReload::WatchDirectory(const string& directory)
+{
+	if (!m_watcher.WatchDirectory(directory))
+		cout << "ERROR::HOT_RELOAD::COULD_NOT_WATCH " << directory << endl;
+}
+
+void HotReload::WatchShader(Shader& shader, function<void(Shader&)> onReload)
+{
+	// shaders built from source in memory have no files to watch
+	if (shader.GetVertexPath().empty())
+		return;
+
+	WatchedShader watched;
+	watched.shader = &shader;
+	watched.files.push_back(CanonicalPath(shader.GetVertexPath()));
+	watched.files.push_back(CanonicalPath(shader.GetFragmentPath()));
+	if (!shader.GetGeometryPath().empty())
+		watched.files.push_back(CanonicalPath(shader.GetGeometryPath()));
+	watched.onReload = onReload;
+	m_shaders.push_back(watched);
+}
+
+void HotReload::UnwatchShader(Shader& shader)
+{
+	m_shaders.erase(std::remove_if(m_shaders.begin(), m_shaders.end(), [&](const WatchedShader& watched) { return watched.shader == &shader; }), m_shaders.end());
+}
+
+void HotReload::Update()
+{
+	vector<string> changed = m_watcher.Poll();
+	if (changed.empty())
+		return;
+
+	// a save can touch the vertex and fragment source at once, rebuild each program only once
+	vector<WatchedShader*> shaders;
+	for (const string& path : changed)
+	{
+		string extension = GetExtension(path);
+		// the baked caches are written next to their sources, those writes are our own
+		if (extension == ".texcache" || extension == ".meshcache" || extension == ".tmp")
+			continue;
+
+		string key = CanonicalPath(path);
+		bool used = false;
+		for (WatchedShader& watched : m_shaders)
+		{
+			if (std::find(watched.files.begin(), watched.files.end(), key) != watched.files.end())
+			{
+				if (std::find(shaders.begin(), shaders.end(), &watched) == shaders.end())
+					shaders.push_back(&watched);
+				used = true;
+			}
+		}
+		used = TextureCache::Get().ReloadFile(path) || used;
+		used = AssetStreamer::Get().ReloadFile(path) || used;
+
+		if (used)
+			cout << "Reloading " << key << endl;
+	}
+
+	for (WatchedShader* watched : shaders)
+	{
+		if (watched->shader->Reload() && watched->onReload)
+		{
+			watched->shader->use();
+			watched->onReload(*watched->shader);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "Shader.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Watches the asset directories and rebuilds whatever was built from a file that changed: shader programs,
+// textures (TextureCache) and models (AssetStreamer). Nothing else is reloaded. All swaps happen on the GL
+// thread between frames, a shader that fails to compile keeps its previous program.
+class HotReload
+{
+public:
+	static HotReload& Get();
+
+	// reports writes to any file below the directory
+	void WatchDirectory(const string& directory);
+
+	// recompiles the shader when one of its sources changes and then calls onReload, which should set the
+	// uniforms that are only set once. The shader must outlive the watch.
+	void WatchShader(Shader& shader, function<void(Shader&)> onReload = function<void(Shader&)>());
+	void UnwatchShader(Shader& shader);
+
+	// GL thread, once per frame before AssetStreamer::Update
+	void Update();
+
+private:
+	HotReload() {}
+
+	struct WatchedShader {
+		Shader* shader;
+		vector<string> files;	// canonical source paths
+		function<void(Shader&)> onReload;
+	};
+
+	FileWatcher m_watcher;
+	vector<WatchedShader> m_shaders;
+};
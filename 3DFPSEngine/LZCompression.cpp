@@ -0,0 +1,146 @@
+#include "LZCompression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;	// the block format requires the last 5 bytes to be literals
+static const size_t MATCH_LIMIT = 12;	// and no match to start within the last 12 bytes
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 16;
+static const uint32_t NO_POSITION = 0xffffffff;
+
+static uint32_t Read32(const unsigned char* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static uint32_t HashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// lengths of 15 and more continue in extra bytes of 255 each plus a final remainder
+static void WriteLength(std::vector<unsigned char>& out, size_t length)
+{
+	while (length >= 255)
+	{
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back((unsigned char)length);
+}
+
+static bool ReadLength(const unsigned char* data, size_t size, size_t& in, size_t& length)
+{
+	unsigned char byte;
+	do
+	{
+		if (in >= size)
+			return false;
+		byte = data[in++];
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+std::vector<unsigned char> CompressLZ(const unsigned char* data, size_t size)
+{
+	std::vector<unsigned char> out;
+	out.reserve(size / 2 + 16);
+
+	// greedy parse, the table remembers the last position of each hashed 4 byte sequence
+	std::vector<uint32_t> table((size_t)1 << HASH_BITS, NO_POSITION);
+	size_t anchor = 0;
+	if (size > MATCH_LIMIT)
+	{
+		size_t end = size - LAST_LITERALS;
+		size_t position = 0;
+		while (position < size - MATCH_LIMIT)
+		{
+			uint32_t sequence = Read32(data + position);
+			uint32_t& slot = table[HashSequence(sequence)];
+			size_t candidate = slot;
+			slot = (uint32_t)position;
+			if (candidate == NO_POSITION || position - candidate > MAX_OFFSET || Read32(data + candidate) != sequence)
+			{
+				position++;
+				continue;
+			}
+
+			size_t length = MIN_MATCH;
+			while (position + length < end && data[candidate + length] == data[position + length])
+				length++;
+
+			size_t literals = position - anchor;
+			size_t matchCode = length - MIN_MATCH;
+			out.push_back((unsigned char)((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15)));
+			if (literals >= 15)
+				WriteLength(out, literals - 15);
+			out.insert(out.end(), data + anchor, data + position);
+			size_t offset = position - candidate;
+			out.push_back((unsigned char)(offset & 0xff));
+			out.push_back((unsigned char)(offset >> 8));
+			if (matchCode >= 15)
+				WriteLength(out, matchCode - 15);
+
+			position += length;
+			anchor = position;
+		}
+	}
+
+	// the last sequence is literals only
+	size_t literals = size - anchor;
+	out.push_back((unsigned char)(std::min<size_t>(literals, 15) << 4));
+	if (literals >= 15)
+		WriteLength(out, literals - 15);
+	out.insert(out.end(), data + anchor, data + size);
+	return out;
+}
+
+bool DecompressLZ(const unsigned char* data, size_t size, unsigned char* out, size_t outSize)
+{
+	size_t in = 0, written = 0;
+	while (in < size)
+	{
+		unsigned char token = data[in++];
+
+		size_t literals = token >> 4;
+		if (literals == 15 && !ReadLength(data, size, in, literals))
+			return false;
+		if (literals > size - in || literals > outSize - written)
+			return false;
+		memcpy(out + written, data + in, literals);
+		in += literals;
+		written += literals;
+		if (in == size)
+			break;
+
+		if (size - in < 2)
+			return false;
+		size_t offset = data[in] | ((size_t)data[in + 1] << 8);
+		in += 2;
+		if (offset == 0 || offset > written)
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !ReadLength(data, size, in, length))
+			return false;
+		length += MIN_MATCH;
+		if (length > outSize - written)
+			return false;
+
+		// a match may overlap the bytes it produces (runs), so only copy in one go when it doesn't
+		unsigned char* target = out + written;
+		if (offset >= length)
+			memcpy(target, target - offset, length);
+		else
+			for (size_t i = 0; i < length; i++)
+				target[i] = target[i - offset];
+		written += length;
+	}
+	return written == outSize;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Byte oriented LZ77 in the LZ4 block format: no entropy coding, so decompression runs at memory speed.
+// Used for the entries of the pak archive that are read once (sources, shaders), not for data used in place.
+
+// compresses a buffer, the result may be larger than the input for incompressible data
+std::vector<unsigned char> CompressLZ(const unsigned char* data, size_t size);
+
+// decompresses into a buffer of exactly the original size, returns false if the input is corrupt
+bool DecompressLZ(const unsigned char* data, size_t size, unsigned char* out, size_t outSize);
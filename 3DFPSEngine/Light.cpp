@@ -0,0 +1,107 @@
+#include "Light.h"
+#include "LightManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Light::Light(LightType type) : m_type(type)
+{
+	SetCone(12.5f, 15.0f);
+	LightManager::Get().Add(this);
+}
+
+Light::~Light()
+{
+	if (m_slot >= 0)
+		LightManager::Get().Remove(this);
+}
+
+void Light::Update(Transform transform)
+{
+	glm::quat rotation = transform.GetTransformedRot();
+	setWorld(transform.GetTransformedPos() + rotation * m_position, rotation * m_direction);
+}
+
+void Light::setWorld(const glm::vec3& position, const glm::vec3& direction)
+{
+	if (position == m_worldPosition && direction == m_worldDirection)
+		return;
+	m_worldPosition = position;
+	m_worldDirection = direction;
+	m_dirty = true;
+}
+
+void Light::SetType(LightType type)
+{
+	m_dirty |= type != m_type;
+	m_type = type;
+}
+
+void Light::SetPosition(const glm::vec3& position)
+{
+	// until a transform places the light, the values set are the world ones
+	m_position = position;
+	setWorld(position, m_worldDirection);
+}
+
+void Light::SetDirection(const glm::vec3& direction)
+{
+	m_direction = glm::normalize(direction);
+	setWorld(m_worldPosition, m_direction);
+}
+
+void Light::SetColors(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular)
+{
+	m_dirty |= ambient != m_ambient || diffuse != m_diffuse || specular != m_specular;
+	m_ambient = ambient;
+	m_diffuse = diffuse;
+	m_specular = specular;
+}
+
+void Light::SetAttenuation(float constant, float linear, float quadratic)
+{
+	m_dirty |= constant != m_constant || linear != m_linear || quadratic != m_quadratic;
+	m_constant = constant;
+	m_linear = linear;
+	m_quadratic = quadratic;
+}
+
+void Light::SetCone(float innerDegrees, float outerDegrees)
+{
+	float cosInner = std::cos(glm::radians(innerDegrees));
+	float cosOuter = std::cos(glm::radians(outerDegrees));
+	m_dirty |= cosInner != m_cosInner || cosOuter != m_cosOuter;
+	m_cosInner = cosInner;
+	m_cosOuter = cosOuter;
+}
+
+void Light::SetEnabled(bool enabled)
+{
+	if (enabled == m_enabled)
+		return;
+	m_enabled = enabled;
+	if (enabled)
+		LightManager::Get().Add(this);
+	else
+		LightManager::Get().Remove(this);
+}
+
+float Light::GetRange() const
+{
+	if (m_type == LightType::Directional)
+		return std::numeric_limits<float>::max();
+
+	// solve brightest * attenuation(d) = 1/256 for d
+	float brightest = 0.0f;
+	for (int c = 0; c < 3; c++)
+		brightest = std::max(brightest, std::max(m_ambient[c], std::max(m_diffuse[c], m_specular[c])));
+	float offset = m_constant - 256.0f * brightest;
+	if (offset >= 0.0f)
+		return 0.0f;
+	if (m_quadratic > 0.0f)
+		return (-m_linear + std::sqrt(m_linear * m_linear - 4.0f * m_quadratic * offset)) / (2.0f * m_quadratic);
+	if (m_linear > 0.0f)
+		return -offset / m_linear;
+	return std::numeric_limits<float>::max();
+}
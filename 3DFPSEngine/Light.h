@@ -0,0 +1,80 @@
+#pragma once
+
+#include "GameComponent.h"
+
+#include <glm/glm.hpp>
+
+enum class LightType {
+	Directional = 0,
+	Point = 1,
+	Spot = 2
+};
+
+// A light source, lit by the shaders through the buffer LightManager packs every enabled light into.
+// Attached to a GameObject its position and direction are relative to the object's transform, otherwise they
+// are in world space. Changing any property marks the light for upload on the next LightManager::Update.
+// GL thread only.
+class Light : public GameComponent
+{
+public:
+	explicit Light(LightType type = LightType::Point);
+	~Light();
+
+	// the manager keeps a pointer to every light
+	Light(const Light&) = delete;
+	Light& operator=(const Light&) = delete;
+
+	void Update(Transform transform);
+
+	void SetType(LightType type);
+	void SetPosition(const glm::vec3& position);
+	void SetDirection(const glm::vec3& direction);
+	void SetColors(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular);
+	// intensity falls off as 1 / (constant + linear * d + quadratic * d^2), directional lights don't attenuate
+	void SetAttenuation(float constant, float linear, float quadratic);
+	// full intensity inside the inner angle, fading to none at the outer one, in degrees. Spot lights only.
+	void SetCone(float innerDegrees, float outerDegrees);
+	// disabled lights are left out of the light buffer altogether
+	void SetEnabled(bool enabled);
+
+	LightType GetType() const { return m_type; }
+	bool IsEnabled() const { return m_enabled; }
+	glm::vec3 GetWorldPosition() const { return m_worldPosition; }
+	glm::vec3 GetWorldDirection() const { return m_worldDirection; }
+	glm::vec3 GetAmbient() const { return m_ambient; }
+	glm::vec3 GetDiffuse() const { return m_diffuse; }
+	glm::vec3 GetSpecular() const { return m_specular; }
+	float GetConstant() const { return m_constant; }
+	float GetLinear() const { return m_linear; }
+	float GetQuadratic() const { return m_quadratic; }
+	float GetCosInner() const { return m_cosInner; }
+	float GetCosOuter() const { return m_cosOuter; }
+
+	// distance at which the brightest colour has fallen below 1/256, the light is ignored beyond it.
+	// Infinite for directional lights.
+	float GetRange() const;
+
+private:
+	friend class LightManager;
+
+	void setWorld(const glm::vec3& position, const glm::vec3& direction);
+
+	LightType m_type;
+	glm::vec3 m_position = glm::vec3(0.0f);
+	glm::vec3 m_direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 m_worldPosition = glm::vec3(0.0f);
+	glm::vec3 m_worldDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 m_ambient = glm::vec3(0.0f);
+	glm::vec3 m_diffuse = glm::vec3(1.0f);
+	glm::vec3 m_specular = glm::vec3(1.0f);
+	float m_constant = 1.0f;
+	float m_linear = 0.09f;
+	float m_quadratic = 0.032f;
+	float m_cosInner = 1.0f;
+	float m_cosOuter = 1.0f;
+	bool m_enabled = true;
+
+	// LightManager bookkeeping
+	bool m_dirty = true;	// changed since it was last uploaded
+	int m_slot = -1;		// index in the light buffer, -1 while disabled
+};
@@ -0,0 +1,50 @@
+#include "LightBenchmark.h"
+
+#include "LightClusters.h"
+#include "Profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <random>
+
+int RunLightBenchmark()
+{
+	const int WIDTH = 1280, HEIGHT = 720, FRAMES = 100;
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / HEIGHT, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	LightClusters& clusters = LightClusters::Get();
+	bool parallel = LightClusters::parallelBinning;
+
+	std::printf("%8s %16s %16s %14s %14s\n", "lights", "parallel (ms)", "serial (ms)", "avg/cluster", "max/cluster");
+	for (int count : { 10, 100, 1000, 10000 })
+	{
+		// point lights scattered through the view frustum and beyond
+		std::mt19937 random(count);
+		std::uniform_real_distribution<float> across(-40.0f, 40.0f), depth(-95.0f, 2.0f), range(1.0f, 8.0f);
+		vector<LightClusters::LightSphere> lights(count);
+		for (auto& light : lights)
+		{
+			light.position = glm::vec3(across(random), across(random) * 0.5f, depth(random));
+			light.range = range(random);
+		}
+
+		double ms[2];
+		for (int serial = 0; serial < 2; serial++)
+		{
+			LightClusters::parallelBinning = serial == 0;
+			clusters.Bin(projection, view, WIDTH, HEIGHT, lights);	// warm up, builds the cluster bounds
+			Profiler::Clock::time_point start = Profiler::Clock::now();
+			for (int frame = 0; frame < FRAMES; frame++)
+				clusters.Bin(projection, view, WIDTH, HEIGHT, lights);
+			ms[serial] = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() / FRAMES;
+		}
+
+		std::printf("%8d %16.3f %16.3f %14.2f %14u\n", count, ms[0], ms[1],
+			(double)clusters.GetIndexCount() / LightClusters::COUNT, clusters.GetMaxClusterLights());
+	}
+
+	LightClusters::parallelBinning = parallel;
+	return 0;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Bins 10 to 10000 random point lights into the clusters of a 1280x720 view, with and without the thread pool, and
+// prints the time per frame and the lights per cluster. CPU only, run with --bench-lights.
+int RunLightBenchmark();
@@ -0,0 +1,309 @@
+#include "LightClusters.h"
+#include "GLState.h"
+#include "LightManager.h"
+#include "ThreadPool.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// SSE2 is part of every x64 target, and of 32 bit ones built for it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+static_assert(LightClusters::GRID_X % 4 == 0, "tile rows are tested four clusters at a time");
+
+const char* const LightClusters::BLOCK_NAME = "Clusters";
+bool LightClusters::enabled = true;
+bool LightClusters::parallelBinning = true;
+
+LightClusters& LightClusters::Get()
+{
+	static LightClusters clusters;
+	return clusters;
+}
+
+// squared distance from the point to the box, 0 inside
+static float BoxDistance2(const glm::vec3& point, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	glm::vec3 outside = glm::max(boxMin - point, glm::vec3(0.0f)) + glm::max(point - boxMax, glm::vec3(0.0f));
+	return glm::dot(outside, outside);
+}
+
+// sphere against the four boxes starting at the given index, bit i of the result is set if box i is reached
+static int TestFour(const float* const boxMin[3], const float* const boxMax[3], size_t index, const glm::vec3& center, float radius2)
+{
+#ifdef LIGHT_CLUSTERS_SSE2
+	__m128 zero = _mm_setzero_ps();
+	__m128 distance2 = zero;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		__m128 c = _mm_set1_ps(center[axis]);
+		__m128 below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(boxMin[axis] + index), c), zero);
+		__m128 above = _mm_max_ps(_mm_sub_ps(c, _mm_loadu_ps(boxMax[axis] + index)), zero);
+		__m128 outside = _mm_add_ps(below, above);
+		distance2 = _mm_add_ps(distance2, _mm_mul_ps(outside, outside));
+	}
+	return _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_set1_ps(radius2)));
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float distance2 = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float outside = std::max(boxMin[axis][index + i] - center[axis], 0.0f) + std::max(center[axis] - boxMax[axis][index + i], 0.0f);
+			distance2 += outside * outside;
+		}
+		if (distance2 <= radius2)
+			mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+void LightClusters::buildBounds(const glm::mat4& projection, int width, int height)
+{
+	m_boundsProjection = projection;
+	m_width = width;
+	m_height = height;
+
+	// planes of a GL perspective projection
+	m_near = projection[3][2] / (projection[2][2] - 1.0f);
+	m_far = projection[3][2] / (projection[2][2] + 1.0f);
+	m_sliceScale = GRID_Z / std::log(m_far / m_near);
+	m_sliceBias = -std::log(m_near) * m_sliceScale;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_min[axis].resize(COUNT);
+		m_max[axis].resize(COUNT);
+	}
+	m_rowMin.assign(GRID_Y * GRID_Z, glm::vec3(FLT_MAX));
+	m_rowMax.assign(GRID_Y * GRID_Z, glm::vec3(-FLT_MAX));
+
+	// the corners of a tile on the near plane, scaled out to the depths bounding each slice
+	glm::mat4 inverse = glm::inverse(projection);
+	int tileWidth = (width + GRID_X - 1) / GRID_X;
+	int tileHeight = (height + GRID_Y - 1) / GRID_Y;
+	for (int y = 0; y < GRID_Y; y++)
+	{
+		for (int x = 0; x < GRID_X; x++)
+		{
+			glm::vec3 corners[4];
+			for (int c = 0; c < 4; c++)
+			{
+				float ndcX = (float)((x + (c & 1)) * tileWidth) / width * 2.0f - 1.0f;
+				float ndcY = (float)((y + (c >> 1)) * tileHeight) / height * 2.0f - 1.0f;
+				glm::vec4 point = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+				corners[c] = glm::vec3(point) / point.w;
+			}
+
+			for (int z = 0; z < GRID_Z; z++)
+			{
+				float depths[2] = { m_near * std::pow(m_far / m_near, (float)z / GRID_Z), m_near * std::pow(m_far / m_near, (float)(z + 1) / GRID_Z) };
+				glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+				for (float depth : depths)
+					for (const glm::vec3& corner : corners)
+					{
+						glm::vec3 point = corner * (depth / m_near);
+						boxMin = glm::min(boxMin, point);
+						boxMax = glm::max(boxMax, point);
+					}
+
+				size_t cluster = (size_t)z * TILES + y * GRID_X + x;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					m_min[axis][cluster] = boxMin[axis];
+					m_max[axis][cluster] = boxMax[axis];
+				}
+				size_t row = (size_t)z * GRID_Y + y;
+				m_rowMin[row] = glm::min(m_rowMin[row], boxMin);
+				m_rowMax[row] = glm::max(m_rowMax[row], boxMax);
+			}
+		}
+	}
+}
+
+void LightClusters::binSlice(int z)
+{
+	Slice& slice = m_slices[z];
+	slice.hits.clear();
+
+	const float* const boxMin[3] = { m_min[0].data(), m_min[1].data(), m_min[2].data() };
+	const float* const boxMax[3] = { m_max[0].data(), m_max[1].data(), m_max[2].data() };
+	for (size_t l = 0; l < m_spheres.size(); l++)
+	{
+		const ViewSphere& sphere = m_spheres[l];
+		if (z < sphere.firstSlice || z > sphere.lastSlice)
+			continue;
+
+		float radius2 = sphere.radius * sphere.radius;
+		for (int y = 0; y < GRID_Y; y++)
+		{
+			size_t row = (size_t)z * GRID_Y + y;
+			if (BoxDistance2(sphere.center, m_rowMin[row], m_rowMax[row]) > radius2)
+				continue;
+
+			for (int x = 0; x < GRID_X; x += 4)
+			{
+				int mask = TestFour(boxMin, boxMax, row * GRID_X + x, sphere.center, radius2);
+				for (int i = 0; mask != 0; i++, mask >>= 1)
+					if (mask & 1)
+						slice.hits.push_back((uint32_t)(y * GRID_X + x + i) << 24 | (uint32_t)l);
+			}
+		}
+	}
+
+	// counting sort by tile, which keeps the lights of each tile in order
+	std::fill(slice.counts, slice.counts + TILES, 0u);
+	for (uint32_t hit : slice.hits)
+		slice.counts[hit >> 24]++;
+	unsigned int offsets[TILES];
+	unsigned int offset = 0;
+	for (int t = 0; t < TILES; t++)
+	{
+		offsets[t] = offset;
+		offset += slice.counts[t];
+	}
+	slice.indices.resize(slice.hits.size());
+	for (uint32_t hit : slice.hits)
+		slice.indices[offsets[hit >> 24]++] = m_sphereLights[hit & 0xffffff];
+}
+
+void LightClusters::Bin(const glm::mat4& projection, const glm::mat4& view, int width, int height, const vector<LightSphere>& lights)
+{
+	if (projection != m_boundsProjection || width != m_width || height != m_height)
+		buildBounds(projection, width, height);
+
+	// global lights go first, the others into view space with the range of slices they touch
+	m_indices.clear();
+	m_spheres.clear();
+	m_sphereLights.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].range < 0.0f)
+		{
+			m_indices.push_back((uint32_t)i);
+			continue;
+		}
+
+		ViewSphere sphere;
+		sphere.center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		sphere.radius = lights[i].range;
+		float depth = -sphere.center.z;
+		if (depth + sphere.radius < m_near || depth - sphere.radius > m_far)
+			continue;
+		auto sliceOf = [this](float d) { return std::min(std::max((int)(std::log(d) * m_sliceScale + m_sliceBias), 0), GRID_Z - 1); };
+		sphere.firstSlice = sliceOf(std::max(depth - sphere.radius, m_near));
+		sphere.lastSlice = sliceOf(std::min(depth + sphere.radius, m_far));
+		m_spheres.push_back(sphere);
+		m_sphereLights.push_back((uint32_t)i);
+	}
+	m_globalCount = (unsigned int)m_indices.size();
+
+	// every slice writes only its own output, so they need no synchronization. A handful of lights isn't worth the
+	// hand-off to the pool.
+	if (parallelBinning && m_spheres.size() >= 64)
+		ThreadPool::Get().ParallelFor(GRID_Z, [this](size_t z) { binSlice((int)z); });
+	else
+		for (int z = 0; z < GRID_Z; z++)
+			binSlice(z);
+
+	m_cells.resize(COUNT * 2);
+	for (int z = 0; z < GRID_Z; z++)
+	{
+		const Slice& slice = m_slices[z];
+		unsigned int offset = (unsigned int)m_indices.size();
+		for (int t = 0; t < TILES; t++)
+		{
+			size_t cluster = (size_t)z * TILES + t;
+			m_cells[cluster * 2] = offset;
+			m_cells[cluster * 2 + 1] = slice.counts[t];
+			offset += slice.counts[t];
+		}
+		m_indices.insert(m_indices.end(), slice.indices.begin(), slice.indices.end());
+	}
+}
+
+unsigned int LightClusters::GetMaxClusterLights() const
+{
+	unsigned int most = 0;
+	for (size_t i = 1; i < m_cells.size(); i += 2)
+		most = std::max(most, m_cells[i]);
+	return most;
+}
+
+void LightClusters::Upload()
+{
+	if (m_uniforms == 0)
+	{
+		glGenBuffers(1, &m_cellBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+		glGenTextures(1, &m_cellTexture);
+		glGenTextures(1, &m_indexTexture);
+		glGenBuffers(1, &m_uniforms);
+
+		// the textures keep referring to the buffers when their storage is replaced below
+		GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, m_cellBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, COUNT * 2 * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+		GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+		GLState::Get().BindTexture(GL_TEXTURE_BUFFER, m_cellTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_cellBuffer);
+		GLState::Get().BindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_indexBuffer);
+		GLState::Get().BindTexture(GL_TEXTURE_BUFFER, 0);
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_uniforms);
+		glBufferData(GL_UNIFORM_BUFFER, 3 * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	// fresh storage every frame, so the upload never waits for the previous frame's draws
+	if (enabled && !m_cells.empty())
+	{
+		GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, m_cellBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, m_cells.size() * sizeof(uint32_t), m_cells.data(), GL_STREAM_DRAW);
+		GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, std::max(m_indices.size(), (size_t)1) * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+		if (!m_indices.empty())
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, m_indices.size() * sizeof(uint32_t), m_indices.data());
+		GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	struct {
+		glm::ivec4 grid;
+		glm::vec4 depth;
+		glm::vec4 tile;
+	} block;
+	bool clustered = enabled && !m_cells.empty();
+	block.grid = clustered ? glm::ivec4(GRID_X, GRID_Y, GRID_Z, (int)m_globalCount) : glm::ivec4(0);
+	block.depth = glm::vec4(m_sliceScale, m_sliceBias, 0.0f, 0.0f);
+	block.tile = glm::vec4((float)((m_width + GRID_X - 1) / GRID_X), (float)((m_height + GRID_Y - 1) / GRID_Y), 0.0f, 0.0f);
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_uniforms);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	GLState::Get().BindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_uniforms);
+	GLState::Get().BindTextureUnit(CLUSTER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_cellTexture);
+	GLState::Get().BindTextureUnit(INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_indexTexture);
+}
+
+void LightClusters::Update(const glm::mat4& projection, const glm::mat4& view, int width, int height)
+{
+	if (enabled)
+	{
+		const vector<Light*>& lights = LightManager::Get().GetLights();
+		m_input.resize(lights.size());
+		for (size_t i = 0; i < lights.size(); i++)
+		{
+			m_input[i].position = lights[i]->GetWorldPosition();
+			m_input[i].range = lights[i]->GetType() == LightType::Directional ? -1.0f : lights[i]->GetRange();
+		}
+		Bin(projection, view, width, height, m_input);
+	}
+	Upload();
+}
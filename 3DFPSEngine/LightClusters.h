@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Clustered forward lighting. The view frustum is split into GRID_X x GRID_Y screen tiles times GRID_Z depth slices,
+// spaced exponentially between the near and far plane, and every cluster gets the list of lights whose bounding
+// sphere reaches into it. The lighting shader finds its fragment's cluster and only evaluates those lights.
+// Lights without a range (directional ones) reach every cluster and are listed once, ahead of the cluster lists.
+//
+// Binning runs on the CPU: one task per depth slice on the thread pool, testing four clusters per SSE instruction.
+// The result goes to the GPU as two buffer textures, 'usamplerBuffer clusterData' (RG32UI, per cluster the offset
+// and count of its lights in the index list) and 'usamplerBuffer clusterLights' (R32UI, LightManager slots), and
+//
+//   layout (std140) uniform Clusters {
+//       ivec4 clusterGrid;		// xyz: clusters along each axis, 0 when clustering is off; w: global lights
+//       vec4 clusterDepth;		// slice = int(log(view depth) * x + y)
+//       vec4 clusterTile;		// xy: tile size in pixels
+//   };
+class LightClusters
+{
+public:
+	static const int GRID_X = 16;
+	static const int GRID_Y = 9;
+	static const int GRID_Z = 24;
+	static const int TILES = GRID_X * GRID_Y;
+	static const int COUNT = TILES * GRID_Z;
+
+	static const char* const BLOCK_NAME;
+	static const unsigned int BINDING = 2;
+	static const unsigned int CLUSTER_TEXTURE_UNIT = 14;
+	static const unsigned int INDEX_TEXTURE_UNIT = 13;
+
+	// off: the shaders loop over every light
+	static bool enabled;
+	// bin the depth slices on the thread pool, otherwise all on the calling thread
+	static bool parallelBinning;
+
+	// a light as the binning sees it, in world space. A negative range reaches everywhere.
+	struct LightSphere {
+		glm::vec3 position;
+		float range;
+	};
+
+	static LightClusters& Get();
+
+	// CPU only: bins the lights into the clusters of the given camera, the index of a light in the vector is what
+	// the lists hold. The cluster bounds are rebuilt when the projection or viewport changed.
+	void Bin(const glm::mat4& projection, const glm::mat4& view, int width, int height, const vector<LightSphere>& lights);
+	// GL thread: uploads the lists of the last Bin and binds them
+	void Upload();
+	// GL thread, once per frame after LightManager::Update: bins the LightManager's lights and uploads the result
+	void Update(const glm::mat4& projection, const glm::mat4& view, int width, int height);
+
+	// entries in the index list of the last Bin, global lights included
+	size_t GetIndexCount() const { return m_indices.size(); }
+	// largest number of lights a single cluster got in the last Bin
+	unsigned int GetMaxClusterLights() const;
+
+private:
+	LightClusters() {}
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	// a light in view space with the slices it overlaps
+	struct ViewSphere {
+		glm::vec3 center;
+		float radius;
+		int firstSlice;
+		int lastSlice;
+	};
+
+	// the output of one slice, tile lists in tile order
+	struct Slice {
+		vector<uint32_t> hits;		// tile << 24 | light, in light order
+		vector<uint32_t> indices;
+		unsigned int counts[TILES];
+	};
+
+	void buildBounds(const glm::mat4& projection, int width, int height);
+	void binSlice(int z);
+
+	// cluster bounds in view space, one array per component, indexed like the clusters
+	vector<float> m_min[3];
+	vector<float> m_max[3];
+	// bounds of each tile row of a slice, for rejecting whole rows at once
+	vector<glm::vec3> m_rowMin;
+	vector<glm::vec3> m_rowMax;
+	glm::mat4 m_boundsProjection = glm::mat4(0.0f);
+	int m_width = 0;
+	int m_height = 0;
+	float m_near = 0.1f;
+	float m_far = 100.0f;
+	float m_sliceScale = 0.0f;
+	float m_sliceBias = 0.0f;
+
+	vector<LightSphere> m_input;		// the LightManager's lights, for Update
+	vector<ViewSphere> m_spheres;	// finite lights of the current Bin
+	vector<uint32_t> m_sphereLights;	// their light indices
+	Slice m_slices[GRID_Z];
+
+	// result of the last Bin
+	vector<uint32_t> m_cells;		// offset, count per cluster
+	vector<uint32_t> m_indices;		// global lights first, then the cluster lists
+	unsigned int m_globalCount = 0;
+
+	unsigned int m_cellBuffer = 0;
+	unsigned int m_cellTexture = 0;
+	unsigned int m_indexBuffer = 0;
+	unsigned int m_indexTexture = 0;
+	unsigned int m_uniforms = 0;
+};
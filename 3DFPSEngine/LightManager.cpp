@@ -0,0 +1,104 @@
+#include "LightManager.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+const char* const LightManager::BLOCK_NAME = "Lights";
+
+LightManager& LightManager::Get()
+{
+	static LightManager manager;
+	return manager;
+}
+
+void LightManager::Add(Light* light)
+{
+	light->m_slot = (int)m_lights.size();
+	light->m_dirty = true;
+	m_lights.push_back(light);
+	m_countChanged = true;
+}
+
+void LightManager::Remove(Light* light)
+{
+	// the last light moves into the freed slot, so the buffer stays packed
+	int slot = light->m_slot;
+	Light* last = m_lights.back();
+	m_lights[slot] = last;
+	last->m_slot = slot;
+	last->m_dirty = true;
+	m_lights.pop_back();
+	light->m_slot = -1;
+	m_countChanged = true;
+}
+
+void LightManager::pack(const Light& light, glm::vec4* texels) const
+{
+	texels[0] = glm::vec4(light.GetWorldPosition(), (float)light.GetType());
+	texels[1] = glm::vec4(light.GetWorldDirection(), light.GetRange());
+	texels[2] = glm::vec4(light.GetAmbient(), light.GetConstant());
+	texels[3] = glm::vec4(light.GetDiffuse(), light.GetLinear());
+	texels[4] = glm::vec4(light.GetSpecular(), light.GetQuadratic());
+	texels[5] = glm::vec4(light.GetCosInner(), light.GetCosOuter(), 0.0f, 0.0f);
+}
+
+void LightManager::Update()
+{
+	const size_t LIGHT_BYTES = TEXELS_PER_LIGHT * sizeof(glm::vec4);
+
+	if (m_buffer == 0)
+	{
+		glGenBuffers(1, &m_buffer);
+		glGenTextures(1, &m_texture);
+		glGenBuffers(1, &m_uniforms);
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_uniforms);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::ivec4), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+	if (m_lights.size() > m_capacity || m_capacity == 0)
+	{
+		// grows by doubling, everything is written again into the new storage
+		m_capacity = std::max(std::max(m_capacity * 2, m_lights.size()), (size_t)16);
+		glBufferData(GL_TEXTURE_BUFFER, m_capacity * LIGHT_BYTES, nullptr, GL_DYNAMIC_DRAW);
+		GLState::Get().BindTexture(GL_TEXTURE_BUFFER, m_texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+		GLState::Get().BindTexture(GL_TEXTURE_BUFFER, 0);
+		for (Light* light : m_lights)
+			light->m_dirty = true;
+	}
+
+	// the CPU copy takes the changed lights, the buffer is rewritten whole whenever any changed
+	m_records.resize(m_lights.size() * TEXELS_PER_LIGHT);
+	m_uploaded = 0;
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		if (!m_lights[i]->m_dirty)
+			continue;
+		pack(*m_lights[i], &m_records[i * TEXELS_PER_LIGHT]);
+		m_lights[i]->m_dirty = false;
+		m_uploaded++;
+	}
+	if (m_uploaded > 0)
+	{
+		// orphan the old contents, the previous frame may still be reading them
+		glBufferData(GL_TEXTURE_BUFFER, m_capacity * LIGHT_BYTES, nullptr, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, m_lights.size() * LIGHT_BYTES, m_records.data());
+	}
+	GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	if (m_countChanged)
+	{
+		glm::ivec4 count((int)m_lights.size(), 0, 0, 0);
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, m_uniforms);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(count), nullptr, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(count), &count);
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, 0);
+		m_countChanged = false;
+	}
+
+	GLState::Get().BindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_uniforms);
+	GLState::Get().BindTextureUnit(TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_texture);
+}
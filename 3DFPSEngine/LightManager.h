@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Light.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+// Packs every enabled Light into one buffer texture the fragment shaders loop over, so the number of lights costs
+// no uniform calls. A light takes TEXELS_PER_LIGHT RGBA32F texels:
+//
+//   0: position.xyz, type				3: diffuse.rgb, linear
+//   1: direction.xyz, range			4: specular.rgb, quadratic
+//   2: ambient.rgb, constant			5: cos inner cone, cos outer cone
+//
+// Shaders declare 'uniform samplerBuffer lightData' (set to TEXTURE_UNIT) and read the count from
+//
+//   layout (std140) uniform Lights {
+//       ivec4 lightCount;	// x
+//   };
+//
+// which Shader binds to BINDING once it is registered with Shader::SetBlockBinding.
+// Only the lights that changed since the last Update are packed, but any change orphans and rewrites the whole
+// buffer from the CPU copy. Patching in place would stall on a buffer the previous frame is still reading, and a
+// few KB per light change costs less than that. Nothing is uploaded when no light changed. GL thread only.
+class LightManager
+{
+public:
+	static const char* const BLOCK_NAME;
+	static const unsigned int BINDING = 1;
+	static const unsigned int TEXTURE_UNIT = 15;
+	static const unsigned int TEXELS_PER_LIGHT = 6;
+
+	static LightManager& Get();
+
+	// once per frame after the scene update moved the lights and before anything lit is drawn: uploads the
+	// buffer if a light changed and binds the buffer texture and the Lights block
+	void Update();
+
+	const vector<Light*>& GetLights() const { return m_lights; }
+	// lights that changed in the last Update, any change rewrites the whole buffer
+	size_t GetUploadedCount() const { return m_uploaded; }
+
+private:
+	friend class Light;
+
+	LightManager() {}
+	LightManager(const LightManager&) = delete;
+	LightManager& operator=(const LightManager&) = delete;
+
+	void Add(Light* light);
+	void Remove(Light* light);
+	void pack(const Light& light, glm::vec4* texels) const;
+
+	vector<Light*> m_lights;		// enabled lights, a light's slot is its index here
+	vector<glm::vec4> m_records;	// CPU copy of the buffer
+	unsigned int m_buffer = 0;
+	unsigned int m_texture = 0;
+	unsigned int m_uniforms = 0;
+	size_t m_capacity = 0;			// lights the buffer has room for
+	bool m_countChanged = true;
+	size_t m_uploaded = 0;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The mapping stays valid until Close() or destruction,
+// so anything pointing into Data() must not outlive the MappedFile.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	// asks the OS to read the whole mapping in ahead of use, in large sequential reads instead of a page fault
+	// per touched page
+	void Prefetch() const;
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const unsigned char* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
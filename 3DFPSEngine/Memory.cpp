@@ -0,0 +1,40 @@
+#include "Memory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+size_t GetResidentMemory()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+}
+
+#else
+
+size_t GetResidentMemory()
+{
+	FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (!statm)
+		return 0;
+
+	unsigned long size = 0, resident = 0;
+	int read = std::fscanf(statm, "%lu %lu", &size, &resident);
+	std::fclose(statm);
+	if (read != 2)
+		return 0;
+	return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#endif
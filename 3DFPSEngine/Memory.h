@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+// resident set size (working set on Windows) of the process in bytes, 0 if it can't be queried
+size_t GetResidentMemory();
@@ -0,0 +1,52 @@
+#include "MemoryReport.h"
+
+#include "FileSystem.h"
+#include "Memory.h"
+#include "Model.h"
+
+#include <cstdio>
+
+static double ToMiB(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// difference of two RSS samples, the allocator may keep freed pages so this can be 0
+static size_t Saved(size_t before, size_t after)
+{
+	return before > after ? before - after : 0;
+}
+
+int RunMemoryReport(const std::string& directory)
+{
+	Assimp::Importer importer;
+	size_t totalCPU = 0, totalSaved = 0, models = 0;
+
+	std::printf("%-48s %12s %12s %12s\n", "model", "CPU copy", "RSS loaded", "RSS saved");
+	for (const std::string& path : ListFiles(directory))
+	{
+		std::string extension = GetExtension(path);
+		if (extension.empty() || !importer.IsExtensionSupported(extension.c_str()))
+			continue;
+
+		Model model(path, false, CPUDataPolicy::Keep);
+		size_t loaded = GetResidentMemory();
+		size_t cpu = model.GetCPUDataSize();
+		model.ReleaseCPUData();
+		size_t released = GetResidentMemory();
+
+		std::printf("%-48s %8.2f MiB %8.2f MiB %8.2f MiB\n", path.c_str(), ToMiB(cpu), ToMiB(loaded), ToMiB(Saved(loaded, released)));
+		totalCPU += cpu;
+		totalSaved += Saved(loaded, released);
+		models++;
+	}
+
+	if (models == 0)
+	{
+		std::printf("no models found in %s\n", directory.c_str());
+		return 1;
+	}
+
+	std::printf("%-48s %8.2f MiB %12s %8.2f MiB\n", "total", ToMiB(totalCPU), "", ToMiB(totalSaved));
+	return 0;
+}
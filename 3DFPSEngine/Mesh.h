@@ -5,133 +5,325 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "GeometryArena.h"
+#include "GLState.h"
+#include "Meshlets.h"
 #include "Shader.h"
+#include "TextureCache.h"
+#include "Vertex.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-	// position
-	glm::vec3 Position;
-	// normal
-	glm::vec3 Normal;
-	// texCoords
-	glm::vec2 TexCoords;
-	// tangent
-	glm::vec3 Tangent;
-	// bitangent
-	glm::vec3 Bitangent;
+// what happens to a mesh's CPU side arrays once they are on the GPU. Keep them only when something like physics
+// or picking still reads them.
+enum class CPUDataPolicy {
+	Release,
+	Keep
 };
 
 struct Texture {
-	unsigned int id = 0;
+	TextureHandle handle; // shared through the TextureCache, empty until loaded
 	string type;
 	string path;
 };
 
+// Lives in a GeometryArena, either its own or one shared with the other meshes of its model. Move-only so the
+// CPU arrays never get copied by accident.
 class Mesh {
 public:
 	/*  Mesh Data  */
-	vector<Vertex> vertices;
+	vector<Vertex> vertices;		// CPU copy, empty unless kept by CPUDataPolicy::Keep
 	vector<unsigned int> indices;
 	vector<Texture> textures;
-	unsigned int VAO;
+	shared_ptr<GeometryArena> arena;	// holds the vertex and index buffers and the VAO
+	GeometryArena::Range range;			// where this mesh's vertices and indices are in the arena
+	unsigned int indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	VertexFormat format = VertexFormat::Float;
+	glm::vec3 boundsMin = glm::vec3(0.0f);		// packed positions decode to boundsMin + position * boundsExtent
+	glm::vec3 boundsExtent = glm::vec3(1.0f);
+
+	// simplified versions of the mesh, coarsest last. They use the same vertices, only the index range differs.
+	struct Lod {
+		size_t indexOffset;
+		unsigned int indexCount;
+		float error;	// object space distance the surface may be off by
+	};
+	vector<Lod> lods;	// levels 1 and up, level 0 is the full detail range above
+
+	// clusters of the full detail level, each a range of its indices. When drawn with a cull view only the visible
+	// ones are submitted, the coarser levels are always drawn whole.
+	vector<Meshlet> meshlets;
+
+	float uvDensity = 0;	// object space units per UV unit, scales screen density to texel density for mip streaming
 
 	/*  Functions  */
-	// constructor
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+	// constructor, move the arrays in to avoid copying them. The mesh gets an arena of its own.
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, CPUDataPolicy policy = CPUDataPolicy::Release)
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
+
+		// the GPU copy of the indices uses 16 bits where possible
+		GLenum type = ChooseIndexType(this->vertices.size());
+		vector<uint16_t> shortIndices;
+		if (type == GL_UNSIGNED_SHORT)
+			shortIndices.assign(this->indices.begin(), this->indices.end());
+		const void* indexData = type == GL_UNSIGNED_SHORT ? (const void*)shortIndices.data() : (const void*)this->indices.data();
 
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		setupMesh(make_shared<GeometryArena>(VertexFormat::Float), this->vertices.data(), (unsigned int)this->vertices.size(),
+			indexData, type, (unsigned int)this->indices.size());
+
+		if (policy == CPUDataPolicy::Release)
+			ReleaseCPUData();
+	}
+
+	// constructor for baked data, uploads straight from the given (e.g. memory mapped) arrays into the arena without
+	// keeping a CPU copy
+	Mesh(shared_ptr<GeometryArena> arena, const Vertex* vertexData, unsigned int numVertices, const void* indexData, GLenum indexType,
+		unsigned int numIndices, vector<Texture> textures)
+	{
+		this->textures = std::move(textures);
+
+		setupMesh(std::move(arena), vertexData, numVertices, indexData, indexType, numIndices);
+	}
+
+	// constructor for quantized baked data, positions are relative to the given bounds
+	Mesh(shared_ptr<GeometryArena> arena, const PackedVertex* vertexData, unsigned int numVertices, glm::vec3 boundsMin, glm::vec3 boundsExtent,
+		const void* indexData, GLenum indexType, unsigned int numIndices, vector<Texture> textures)
+	{
+		this->textures = std::move(textures);
+		this->format = VertexFormat::Packed;
+		this->boundsMin = boundsMin;
+		this->boundsExtent = boundsExtent;
+
+		setupMesh(std::move(arena), vertexData, numVertices, indexData, indexType, numIndices);
+	}
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&&) = default;
+	Mesh& operator=(Mesh&&) = default;
+
+	// frees the CPU copy of the arrays, the GPU buffers are unaffected
+	void ReleaseCPUData()
+	{
+		vector<Vertex>().swap(vertices);
+		vector<unsigned int>().swap(indices);
+	}
+
+	size_t GetCPUDataSize() const
+	{
+		return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+	}
+
+	// uploads a simplified index list (same index type, same vertices) as the next coarser level
+	void AddLod(const void* indexData, unsigned int numIndices, float error)
+	{
+		Lod lod;
+		lod.indexOffset = arena->UploadIndices(indexData, numIndices * GetIndexSize(indexType));
+		lod.indexCount = numIndices;
+		lod.error = error;
+		lods.push_back(lod);
+	}
+
+	unsigned int GetLodCount() const { return 1 + (unsigned int)lods.size(); }
+
+	// render the mesh, levels past the coarsest one draw the coarsest. With a cull view (in the mesh's object space)
+	// the full detail level skips its meshlets that are outside the frustum or face away from the camera.
+	void Draw(Shader &shader, unsigned int lod = 0, const MeshletCullView* cull = nullptr)
+	{
+		arena->Bind();
+		DrawBound(shader, lod, cull);
+	}
+
+	// renders the mesh assuming its arena is already bound, lets a model bind once for all its meshes
+	void DrawBound(Shader &shader, unsigned int lod = 0, const MeshletCullView* cull = nullptr)
+	{
+		// gather the visible ranges first, a mesh with none left needs no texture or uniform changes either
+		lod = std::min(lod, (unsigned int)lods.size());
+		bool culled = cull && lod == 0 && !meshlets.empty();
+		if (culled && !gatherVisibleMeshlets(*cull))
+			return;
+
+		BindMaterial(shader);
+		drawRanges(shader, lod, culled);
+	}
+
+	// renders the mesh assuming its arena and its material (BindMaterial, or an identical one of another mesh) are
+	// already bound, lets a render queue skip the binds that repeat
+	void DrawGeometry(Shader &shader, unsigned int lod = 0, const MeshletCullView* cull = nullptr)
+	{
+		lod = std::min(lod, (unsigned int)lods.size());
+		bool culled = cull && lod == 0 && !meshlets.empty();
+		if (culled && !gatherVisibleMeshlets(*cull))
+			return;
+
+		drawRanges(shader, lod, culled);
+	}
+
+	// draws the level once per instance, assuming the arena's instance attributes point at the instances' model
+	// matrices (GeometryArena::BindInstances) and the material is bound. Instances are not meshlet culled.
+	void DrawInstances(Shader &shader, unsigned int lod, unsigned int instances)
+	{
+		lod = std::min(lod, (unsigned int)lods.size());
+		setDecodeUniforms(shader, true);
+
+		size_t offset = lod ? lods[lod - 1].indexOffset : range.indexOffset;
+		unsigned int count = lod ? lods[lod - 1].indexCount : indexCount;
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, count, indexType, (void*)offset, (GLsizei)instances, (GLint)range.baseVertex);
 	}
 
-	// render the mesh
-	void Draw(Shader shader)
+	// binds the textures to units 0 and up and points the shader's samplers at them
+	void BindMaterial(Shader &shader)
 	{
-		// bind appropriate textures
+		const DrawUniforms& uniforms = resolveUniforms(shader);
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			// set the sampler to the correct texture unit
+			shader.setInt(uniforms.samplers[i], i);
+			// and bind the texture there, units that already hold it are left alone
+			GLState::Get().BindTextureUnit(i, GL_TEXTURE_2D, textures[i].handle ? textures[i].handle->GetID() : 0);
+		}
+	}
+
+private:
+	// handles of the uniforms DrawBound sets, for the shader the mesh was last drawn with
+	struct DrawUniforms {
+		unsigned int shader = 0;			// Shader::GetSerial, 0 before the first draw
+		vector<Shader::Uniform> samplers;	// one per texture
+		Shader::Uniform quantized;
+		Shader::Uniform instanced;
+		Shader::Uniform boundsMin;
+		Shader::Uniform boundsExtent;
+	};
+	DrawUniforms drawUniforms;
+
+	// resolves the handles when the mesh is drawn with a different shader than last time
+	const DrawUniforms& resolveUniforms(Shader &shader)
+	{
+		if (drawUniforms.shader == shader.GetSerial())
+			return drawUniforms;
+
+		drawUniforms.shader = shader.GetSerial();
+		drawUniforms.samplers.clear();
+		// the samplers are named by type and a number counting up per type: texture_diffuseN, texture_specularN,
+		// texture_normalN and texture_heightN
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
 		unsigned int normalNr = 1;
 		unsigned int heightNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++)
+		for (const Texture& texture : textures)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-			// retrieve texture number (the N in diffuse_textureN)
 			string number;
-			string name = textures[i].type;
+			const string& name = texture.type;
 			if (name == "texture_diffuse")
 				number = std::to_string(diffuseNr++);
 			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
+				number = std::to_string(specularNr++);
 			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
+				number = std::to_string(normalNr++);
 			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
+				number = std::to_string(heightNr++);
+			drawUniforms.samplers.push_back(shader.GetUniform(name + number));
+		}
+		drawUniforms.quantized = shader.GetUniform("quantized");
+		drawUniforms.instanced = shader.GetUniform("instanced");
+		drawUniforms.boundsMin = shader.GetUniform("boundsMin");
+		drawUniforms.boundsExtent = shader.GetUniform("boundsExtent");
+		return drawUniforms;
+	}
 
-													 // now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	// tells the vertex shader how to decode the attributes and where the model matrix comes from, set on every
+	// draw so a draw outside the render queue never sees the instanced flag of the last batch
+	void setDecodeUniforms(Shader &shader, bool instanced = false)
+	{
+		const DrawUniforms& uniforms = resolveUniforms(shader);
+		shader.setBool(uniforms.instanced, instanced);
+		bool quantized = format == VertexFormat::Packed;
+		shader.setBool(uniforms.quantized, quantized);
+		if (quantized)
+		{
+			shader.setVec3(uniforms.boundsMin, boundsMin);
+			shader.setVec3(uniforms.boundsExtent, boundsExtent);
 		}
+	}
+
+	// sets the per mesh uniforms and draws the level, or the gathered meshlet ranges
+	void drawRanges(Shader &shader, unsigned int lod, bool culled)
+	{
+		setDecodeUniforms(shader);
 
 		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		if (culled)
+		{
+			DrawScratch& scratch = drawScratch();
+			scratch.baseVertices.assign(scratch.counts.size(), (GLint)range.baseVertex);
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, scratch.counts.data(), indexType, scratch.offsets.data(),
+				(GLsizei)scratch.counts.size(), scratch.baseVertices.data());
+		}
+		else
+		{
+			size_t offset = lod ? lods[lod - 1].indexOffset : range.indexOffset;
+			unsigned int count = lod ? lods[lod - 1].indexCount : indexCount;
+			glDrawElementsBaseVertex(GL_TRIANGLES, count, indexType, (void*)offset, (GLint)range.baseVertex);
+		}
+	}
 
-		// always good practice to set everything back to defaults once configured.
-		glActiveTexture(GL_TEXTURE0);
+	// arguments of the multi draw, reused between draws (GL thread only)
+	struct DrawScratch {
+		vector<GLsizei> counts;
+		vector<const void*> offsets;
+		vector<GLint> baseVertices;
+	};
+	static DrawScratch& drawScratch()
+	{
+		static DrawScratch scratch;
+		return scratch;
 	}
 
-private:
-	/*  Render data  */
-	unsigned int VBO, EBO;
+	// fills the scratch arrays with the index ranges of the visible meshlets, neighbours merged into one range.
+	// Returns false if none is visible.
+	bool gatherVisibleMeshlets(const MeshletCullView& cull)
+	{
+		DrawScratch& scratch = drawScratch();
+		scratch.counts.clear();
+		scratch.offsets.clear();
+		size_t indexSize = GetIndexSize(indexType);
+		unsigned int rangeEnd = ~0u;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (!IsMeshletVisible(meshlet, cull))
+				continue;
+			if (meshlet.firstIndex == rangeEnd)
+				scratch.counts.back() += meshlet.indexCount;
+			else
+			{
+				scratch.counts.push_back(meshlet.indexCount);
+				scratch.offsets.push_back((const void*)(range.indexOffset + meshlet.firstIndex * indexSize));
+			}
+			rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+		}
+		return !scratch.counts.empty();
+	}
 
 	/*  Functions    */
-	// initializes all the buffer objects/arrays
-	void setupMesh()
-	{
-		// create buffers/arrays
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		glBindVertexArray(VAO);
-		// load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		// A great thing about structs is that their memory layout is sequential for all its items.
-		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-		// set the vertex attribute pointers
-		// vertex Positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		// vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-		// vertex texture coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-		// vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-		// vertex bitangent
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-		glBindVertexArray(0);
+	// copies the arrays into the arena
+	void setupMesh(shared_ptr<GeometryArena> arena, const void* vertexData, unsigned int numVertices, const void* indexData, GLenum indexType, unsigned int numIndices)
+	{
+		this->arena = std::move(arena);
+		this->indexCount = numIndices;
+		this->indexType = indexType;
+		range = this->arena->Upload(vertexData, numVertices, indexData, numIndices * GetIndexSize(indexType));
 	}
 };
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// On-disk layout, all offsets are from the start of the file:
+// header | mesh records | texture records | LOD records | meshlet records | string table |
+// (16 byte aligned) vertex and index arrays
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t importFlags;
+	uint32_t vertexFormat;
+	uint32_t vertexSize;
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t lodCount;
+	uint32_t meshletCount;
+	uint32_t reserved;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+struct MeshCacheRecord {
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t firstTexture;
+	uint32_t numTextures;
+	uint32_t indexSize;
+	uint32_t firstLod;
+	uint32_t numLods;
+	float boundsMin[3];
+	float boundsExtent[3];
+	uint32_t firstMeshlet;
+	uint32_t numMeshlets;
+	float uvDensity;
+};
+
+struct MeshCacheLodRecord {
+	uint64_t indexOffset;
+	uint32_t numIndices;
+	float error;
+};
+
+struct MeshCacheMeshletRecord {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneAxis[3];
+	float coneCutoff;
+	uint32_t reserved;
+};
+
+struct MeshCacheTextureRecord {
+	uint32_t typeOffset;
+	uint32_t typeLength;
+	uint32_t pathOffset;
+	uint32_t pathLength;
+};
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool InRange(uint64_t offset, uint64_t size, size_t fileSize)
+{
+	return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool MeshCache::Open(const string& cachePath, uint64_t sourceHash, uint32_t importFlags, VertexFormat format)
+{
+	Close();
+
+	if (!m_file.Open(cachePath))
+		return false;
+
+	const unsigned char* data = m_file.Data();
+	size_t size = m_file.Size();
+
+	if (size < sizeof(MeshCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	MeshCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != VERSION ||
+		header.vertexFormat != (uint32_t)format || header.vertexSize != GetVertexSize(format) ||
+		header.sourceHash != sourceHash || header.importFlags != importFlags)
+	{
+		Close();
+		return false;
+	}
+
+	uint64_t recordsOffset = sizeof(MeshCacheHeader);
+	uint64_t texturesOffset = recordsOffset + (uint64_t)header.meshCount * sizeof(MeshCacheRecord);
+	uint64_t lodsOffset = texturesOffset + (uint64_t)header.textureCount * sizeof(MeshCacheTextureRecord);
+	uint64_t meshletsOffset = lodsOffset + (uint64_t)header.lodCount * sizeof(MeshCacheLodRecord);
+	if (!InRange(recordsOffset, (uint64_t)header.meshCount * sizeof(MeshCacheRecord), size) ||
+		!InRange(texturesOffset, (uint64_t)header.textureCount * sizeof(MeshCacheTextureRecord), size) ||
+		!InRange(lodsOffset, (uint64_t)header.lodCount * sizeof(MeshCacheLodRecord), size) ||
+		!InRange(meshletsOffset, (uint64_t)header.meshletCount * sizeof(MeshCacheMeshletRecord), size) ||
+		!InRange(header.stringsOffset, header.stringsSize, size))
+	{
+		Close();
+		return false;
+	}
+
+	const MeshCacheRecord* records = reinterpret_cast<const MeshCacheRecord*>(data + recordsOffset);
+	const MeshCacheTextureRecord* textures = reinterpret_cast<const MeshCacheTextureRecord*>(data + texturesOffset);
+	const MeshCacheLodRecord* lods = reinterpret_cast<const MeshCacheLodRecord*>(data + lodsOffset);
+	const MeshCacheMeshletRecord* meshlets = reinterpret_cast<const MeshCacheMeshletRecord*>(data + meshletsOffset);
+	const char* strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+	m_meshes.reserve(header.meshCount);
+	for (uint32_t i = 0; i < header.meshCount; i++)
+	{
+		const MeshCacheRecord& record = records[i];
+		if (!InRange(record.vertexOffset, (uint64_t)record.numVertices * header.vertexSize, size) ||
+			(record.indexSize != sizeof(uint16_t) && record.indexSize != sizeof(uint32_t)) ||
+			!InRange(record.indexOffset, (uint64_t)record.numIndices * record.indexSize, size) ||
+			(uint64_t)record.firstTexture + record.numTextures > header.textureCount ||
+			(uint64_t)record.firstLod + record.numLods > header.lodCount ||
+			(uint64_t)record.firstMeshlet + record.numMeshlets > header.meshletCount)
+		{
+			Close();
+			return false;
+		}
+
+		MeshData mesh;
+		if (format == VertexFormat::Packed)
+		{
+			mesh.packedVertices = reinterpret_cast<const PackedVertex*>(data + record.vertexOffset);
+			mesh.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+			mesh.boundsExtent = glm::vec3(record.boundsExtent[0], record.boundsExtent[1], record.boundsExtent[2]);
+		}
+		else
+			mesh.vertices = reinterpret_cast<const Vertex*>(data + record.vertexOffset);
+		mesh.numVertices = record.numVertices;
+		mesh.indices = data + record.indexOffset;
+		mesh.indexType = record.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		mesh.numIndices = record.numIndices;
+		mesh.uvDensity = record.uvDensity;
+		for (uint32_t t = 0; t < record.numTextures; t++)
+		{
+			const MeshCacheTextureRecord& texture = textures[record.firstTexture + t];
+			if (!InRange(texture.typeOffset, texture.typeLength, header.stringsSize) ||
+				!InRange(texture.pathOffset, texture.pathLength, header.stringsSize))
+			{
+				Close();
+				return false;
+			}
+
+			Texture ref;
+			ref.type.assign(strings + texture.typeOffset, texture.typeLength);
+			ref.path.assign(strings + texture.pathOffset, texture.pathLength);
+			mesh.textures.push_back(ref);
+		}
+		for (uint32_t l = 0; l < record.numLods; l++)
+		{
+			const MeshCacheLodRecord& lod = lods[record.firstLod + l];
+			if (!InRange(lod.indexOffset, (uint64_t)lod.numIndices * record.indexSize, size))
+			{
+				Close();
+				return false;
+			}
+
+			MeshLod ref;
+			ref.indices = data + lod.indexOffset;
+			ref.numIndices = lod.numIndices;
+			ref.error = lod.error;
+			mesh.lods.push_back(ref);
+		}
+		for (uint32_t m = 0; m < record.numMeshlets; m++)
+		{
+			const MeshCacheMeshletRecord& meshlet = meshlets[record.firstMeshlet + m];
+			if ((uint64_t)meshlet.firstIndex + meshlet.indexCount > record.numIndices)
+			{
+				Close();
+				return false;
+			}
+
+			Meshlet ref;
+			ref.firstIndex = meshlet.firstIndex;
+			ref.indexCount = meshlet.indexCount;
+			ref.center = glm::vec3(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+			ref.radius = meshlet.radius;
+			ref.coneApex = glm::vec3(meshlet.coneApex[0], meshlet.coneApex[1], meshlet.coneApex[2]);
+			ref.coneAxis = glm::vec3(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+			ref.coneCutoff = meshlet.coneCutoff;
+			mesh.meshlets.push_back(ref);
+		}
+		m_meshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+void MeshCache::Close()
+{
+	m_meshes.clear();
+	m_file.Close();
+}
+
+bool MeshCache::Write(const string& cachePath, uint64_t sourceHash, uint32_t importFlags, VertexFormat format, const vector<MeshData>& meshes)
+{
+	size_t vertexSize = GetVertexSize(format);
+	vector<MeshCacheRecord> records(meshes.size());
+	vector<MeshCacheTextureRecord> textures;
+	vector<MeshCacheLodRecord> lods;
+	vector<MeshCacheMeshletRecord> meshlets;
+	string strings;
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		records[i].firstTexture = (uint32_t)textures.size();
+		records[i].numTextures = (uint32_t)meshes[i].textures.size();
+		records[i].indexSize = (uint32_t)GetIndexSize(meshes[i].indexType);
+		records[i].firstLod = (uint32_t)lods.size();
+		records[i].numLods = (uint32_t)meshes[i].lods.size();
+		records[i].firstMeshlet = (uint32_t)meshlets.size();
+		records[i].numMeshlets = (uint32_t)meshes[i].meshlets.size();
+		records[i].uvDensity = meshes[i].uvDensity;
+		for (const Meshlet& meshlet : meshes[i].meshlets)
+		{
+			MeshCacheMeshletRecord ref;
+			ref.firstIndex = meshlet.firstIndex;
+			ref.indexCount = meshlet.indexCount;
+			ref.radius = meshlet.radius;
+			ref.coneCutoff = meshlet.coneCutoff;
+			ref.reserved = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				ref.center[c] = meshlet.center[c];
+				ref.coneApex[c] = meshlet.coneApex[c];
+				ref.coneAxis[c] = meshlet.coneAxis[c];
+			}
+			meshlets.push_back(ref);
+		}
+		for (const MeshLod& lod : meshes[i].lods)
+		{
+			MeshCacheLodRecord ref;
+			ref.indexOffset = 0;	// filled in with the data layout below
+			ref.numIndices = lod.numIndices;
+			ref.error = lod.error;
+			lods.push_back(ref);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			records[i].boundsMin[c] = meshes[i].boundsMin[c];
+			records[i].boundsExtent[c] = meshes[i].boundsExtent[c];
+		}
+		for (const Texture& texture : meshes[i].textures)
+		{
+			MeshCacheTextureRecord ref;
+			ref.typeOffset = (uint32_t)strings.size();
+			ref.typeLength = (uint32_t)texture.type.size();
+			strings += texture.type;
+			ref.pathOffset = (uint32_t)strings.size();
+			ref.pathLength = (uint32_t)texture.path.size();
+			strings += texture.path;
+			textures.push_back(ref);
+		}
+	}
+
+	MeshCacheHeader header;
+	memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.importFlags = importFlags;
+	header.vertexFormat = (uint32_t)format;
+	header.vertexSize = (uint32_t)vertexSize;
+	header.meshCount = (uint32_t)meshes.size();
+	header.textureCount = (uint32_t)textures.size();
+	header.lodCount = (uint32_t)lods.size();
+	header.meshletCount = (uint32_t)meshlets.size();
+	header.reserved = 0;
+	size_t lodsOffset = sizeof(MeshCacheHeader) + records.size() * sizeof(MeshCacheRecord) + textures.size() * sizeof(MeshCacheTextureRecord);
+	size_t meshletsOffset = lodsOffset + lods.size() * sizeof(MeshCacheLodRecord);
+	header.stringsOffset = meshletsOffset + meshlets.size() * sizeof(MeshCacheMeshletRecord);
+	header.stringsSize = strings.size();
+
+	// lay out the bulk data after the tables so it can be used in place once mapped
+	size_t offset = (size_t)(header.stringsOffset + header.stringsSize);
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		offset = AlignUp(offset, 16);
+		records[i].vertexOffset = offset;
+		records[i].numVertices = meshes[i].numVertices;
+		offset += meshes[i].numVertices * vertexSize;
+
+		offset = AlignUp(offset, 16);
+		records[i].indexOffset = offset;
+		records[i].numIndices = meshes[i].numIndices;
+		offset += meshes[i].numIndices * records[i].indexSize;
+
+		for (uint32_t l = 0; l < records[i].numLods; l++)
+		{
+			offset = AlignUp(offset, 16);
+			lods[records[i].firstLod + l].indexOffset = offset;
+			offset += lods[records[i].firstLod + l].numIndices * records[i].indexSize;
+		}
+	}
+
+	vector<unsigned char> file(offset, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	if (!records.empty())
+		memcpy(&file[sizeof(header)], records.data(), records.size() * sizeof(MeshCacheRecord));
+	if (!textures.empty())
+		memcpy(&file[sizeof(header) + records.size() * sizeof(MeshCacheRecord)], textures.data(), textures.size() * sizeof(MeshCacheTextureRecord));
+	if (!lods.empty())
+		memcpy(&file[lodsOffset], lods.data(), lods.size() * sizeof(MeshCacheLodRecord));
+	if (!meshlets.empty())
+		memcpy(&file[meshletsOffset], meshlets.data(), meshlets.size() * sizeof(MeshCacheMeshletRecord));
+	if (!strings.empty())
+		memcpy(&file[(size_t)header.stringsOffset], strings.data(), strings.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const void* vertices = format == VertexFormat::Packed ? (const void*)meshes[i].packedVertices : (const void*)meshes[i].vertices;
+		if (meshes[i].numVertices > 0)
+			memcpy(&file[(size_t)records[i].vertexOffset], vertices, meshes[i].numVertices * vertexSize);
+		if (meshes[i].numIndices > 0)
+			memcpy(&file[(size_t)records[i].indexOffset], meshes[i].indices, meshes[i].numIndices * records[i].indexSize);
+		for (uint32_t l = 0; l < records[i].numLods; l++)
+		{
+			const MeshLod& lod = meshes[i].lods[l];
+			if (lod.numIndices > 0)
+				memcpy(&file[(size_t)lods[records[i].firstLod + l].indexOffset], lod.indices, lod.numIndices * records[i].indexSize);
+		}
+	}
+
+	// write to a temporary file first so a crash never leaves a half written cache behind
+	string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR::MESH_CACHE::COULD_NOT_WRITE " << tempPath << std::endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(file.data()), file.size());
+		if (!out)
+		{
+			std::cout << "ERROR::MESH_CACHE::COULD_NOT_WRITE " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(cachePath.c_str());
+	if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		std::cout << "ERROR::MESH_CACHE::COULD_NOT_WRITE " << cachePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Meshlets.h"
+#include "PakArchive.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// simplified index list of a mesh, same index type and vertices as the full detail one
+struct MeshLod {
+	const void* indices = nullptr;
+	unsigned int numIndices = 0;
+	float error = 0.0f;
+};
+
+// CPU side arrays of one mesh, ready for upload. The pointers either point straight into a mapped cache file
+// or into arrays owned by whoever produced the mesh.
+struct MeshData {
+	const Vertex* vertices = nullptr;
+	const PackedVertex* packedVertices = nullptr;	// set instead of vertices for the quantized layout
+	glm::vec3 boundsMin = glm::vec3(0.0f);			// bounds the packed positions are relative to
+	glm::vec3 boundsExtent = glm::vec3(1.0f);
+	unsigned int numVertices;
+	const void* indices = nullptr;
+	GLenum indexType = GL_UNSIGNED_INT;				// GL_UNSIGNED_SHORT for meshes ChooseIndexType allows it for
+	unsigned int numIndices;
+	vector<Texture> textures; // type and path, plus the cache handle once acquired
+	vector<MeshLod> lods;		// coarser levels, coarsest last
+	vector<Meshlet> meshlets;	// clusters of the full detail level, in index order
+	float uvDensity = 0;		// object space units per UV unit, 0 when the mesh has no texture coordinates
+};
+
+// Baked binary copy of everything Model::processMesh produces for a model file, so warm starts can skip Assimp.
+// The cache is only used when its version, vertex layout, source file hash and import flags all match.
+// Vertices are stored either as full floats or quantized (PackedVertex), whichever the caller asks for.
+class MeshCache
+{
+public:
+	// bump whenever the file layout or the data written into it changes
+	static const uint32_t VERSION = 8;
+
+	static string GetCachePath(const string& sourcePath) { return sourcePath + ".meshcache"; }
+
+	// maps the cache file and validates it, returns false if it is missing, stale or corrupt
+	bool Open(const string& cachePath, uint64_t sourceHash, uint32_t importFlags, VertexFormat format);
+	void Close();
+
+	const vector<MeshData>& GetMeshes() const { return m_meshes; }
+
+	// writes the meshes to a new cache file, safe to call from any thread. For VertexFormat::Packed every mesh
+	// must have packedVertices set.
+	static bool Write(const string& cachePath, uint64_t sourceHash, uint32_t importFlags, VertexFormat format, const vector<MeshData>& meshes);
+
+private:
+	AssetFile m_file;
+	vector<MeshData> m_meshes;
+};
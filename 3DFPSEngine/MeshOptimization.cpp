@@ -0,0 +1,400 @@
+#include "MeshOptimization.h"
+
+#include "Hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// FIFO post-transform cache simulation, Triangle() returns how many of its vertices missed
+class FifoCache
+{
+public:
+	FifoCache(size_t vertexCount, unsigned int cacheSize) : m_stamps(vertexCount, 0), m_size(cacheSize), m_time(cacheSize + 1) {}
+
+	void Reset() { m_time += m_size + 1; }
+
+	unsigned int Triangle(const unsigned int* triangle)
+	{
+		unsigned int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			// a vertex is cached while fewer than m_size misses happened since it was last loaded
+			if (m_time - m_stamps[triangle[k]] > m_size)
+			{
+				m_stamps[triangle[k]] = m_time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+private:
+	vector<unsigned int> m_stamps;
+	unsigned int m_size;
+	unsigned int m_time;
+};
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indexCount < 3)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	vector<bool> referenced(vertexCount, false);
+	size_t misses = 0, unique = 0;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		misses += cache.Triangle(indices + i);
+		for (int k = 0; k < 3; k++)
+		{
+			if (!referenced[indices[i + k]])
+			{
+				referenced[indices[i + k]] = true;
+				unique++;
+			}
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(indexCount / 3);
+	stats.atvr = unique ? (float)misses / (float)unique : 0.0f;
+	return stats;
+}
+
+// ----- welding -----
+
+// every float of a Vertex, either as its bit pattern or snapped to the epsilon grid
+static const size_t VERTEX_FLOATS = sizeof(Vertex) / sizeof(float);
+
+void WeldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices, float epsilon)
+{
+	if (vertices.empty())
+		return;
+
+	vector<uint32_t> keys(vertices.size() * VERTEX_FLOATS);
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const float* attributes = reinterpret_cast<const float*>(&vertices[v]);
+		uint32_t* key = &keys[v * VERTEX_FLOATS];
+		if (epsilon > 0.0f)
+		{
+			for (size_t f = 0; f < VERTEX_FLOATS; f++)
+				key[f] = (uint32_t)(int32_t)std::floor(attributes[f] / epsilon + 0.5f);
+		}
+		else
+			memcpy(key, attributes, sizeof(Vertex));
+	}
+
+	auto hash = [&keys](unsigned int v) { return (size_t)HashBytes(&keys[v * VERTEX_FLOATS], VERTEX_FLOATS * sizeof(uint32_t)); };
+	auto equal = [&keys](unsigned int a, unsigned int b)
+	{
+		return memcmp(&keys[a * VERTEX_FLOATS], &keys[b * VERTEX_FLOATS], VERTEX_FLOATS * sizeof(uint32_t)) == 0;
+	};
+	std::unordered_map<unsigned int, unsigned int, decltype(hash), decltype(equal)> unique(vertices.size(), hash, equal);
+
+	// the first vertex of each group survives, in the original order
+	vector<unsigned int> remap(vertices.size());
+	vector<Vertex> result;
+	result.reserve(vertices.size());
+	for (unsigned int v = 0; v < (unsigned int)vertices.size(); v++)
+	{
+		auto inserted = unique.insert(std::make_pair(v, (unsigned int)result.size()));
+		if (inserted.second)
+			result.push_back(vertices[v]);
+		remap[v] = inserted.first->second;
+	}
+
+	for (unsigned int& index : indices)
+		index = remap[index];
+	vertices.swap(result);
+}
+
+// ----- vertex cache -----
+
+// Forsyth's scoring, the LRU cache modelled here is a bit larger than the hardware FIFO on purpose
+static const int SCORE_CACHE_SIZE = 32;
+
+static float VertexScore(int cachePosition, unsigned int liveTriangles)
+{
+	// vertices without triangles left are never chosen again
+	if (liveTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the three vertices of the last triangle get a fixed score so the next triangle isn't biased towards them
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.0f - (float)(cachePosition - 3) / (SCORE_CACHE_SIZE - 3), 1.5f);
+	}
+
+	// favour vertices with few triangles left, finishing them off frees cache space
+	score += 2.0f * std::pow((float)liveTriangles, -0.5f);
+	return score;
+}
+
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// triangle adjacency per vertex, live ones are kept at the front of each vertex's range
+	vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+	vector<unsigned int> adjacency(triangleCount * 3);
+	vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(-1, liveTriangles[v]);
+
+	vector<float> triangleScore(triangleCount);
+	vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	vector<unsigned int> result(triangleCount * 3);
+	vector<unsigned int> cache, nextCache;
+	cache.reserve(SCORE_CACHE_SIZE + 3);
+	nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+	size_t cursor = 0;	// dead end fallback: next triangle that might not be emitted yet, in input order
+	long long best = 0;
+	for (size_t t = 1; t < triangleCount; t++)
+		if (triangleScore[t] > triangleScore[best])
+			best = (long long)t;
+
+	for (size_t output = 0; output < triangleCount; output++)
+	{
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = (long long)cursor;
+		}
+
+		const unsigned int* triangle = indices + best * 3;
+		result[output * 3 + 0] = triangle[0];
+		result[output * 3 + 1] = triangle[1];
+		result[output * 3 + 2] = triangle[2];
+		emitted[(size_t)best] = true;
+
+		// drop the triangle from its vertices' live lists
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* begin = &adjacency[offsets[v]];
+			unsigned int* end = begin + liveTriangles[v];
+			unsigned int* found = std::find(begin, end, (unsigned int)best);
+			std::swap(*found, *(end - 1));
+			liveTriangles[v]--;
+		}
+
+		// move the triangle's vertices to the front of the LRU cache
+		nextCache.clear();
+		nextCache.push_back(triangle[0]);
+		nextCache.push_back(triangle[1]);
+		nextCache.push_back(triangle[2]);
+		for (unsigned int v : cache)
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		std::swap(cache, nextCache);
+
+		// rescore everything in (or just evicted from) the cache and pick the best triangle touching it
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			cachePosition[v] = i < (size_t)SCORE_CACHE_SIZE ? (int)i : -1;
+			float score = VertexScore(cachePosition[v], liveTriangles[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (unsigned int a = 0; a < liveTriangles[v]; a++)
+			{
+				unsigned int t = adjacency[offsets[v] + a];
+				triangleScore[t] += delta;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = (long long)t;
+				}
+			}
+		}
+		if (cache.size() > (size_t)SCORE_CACHE_SIZE)
+			cache.resize(SCORE_CACHE_SIZE);
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+// ----- overdraw -----
+
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// hard boundaries where the cache optimized order starts over with three misses
+	FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+	vector<unsigned int> misses(triangleCount);
+	vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		misses[t] = cache.Triangle(indices + t * 3);
+		if (t == 0 || misses[t] == 3)
+			hardBoundaries.push_back(t);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// split further wherever the running ACMR of a cluster is already within the threshold of the whole cluster,
+	// cutting there costs at most that much cache efficiency
+	vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		size_t begin = hardBoundaries[h], end = hardBoundaries[h + 1];
+		unsigned int clusterMisses = 0;
+		for (size_t t = begin; t < end; t++)
+			clusterMisses += misses[t];
+		float clusterThreshold = threshold * (float)clusterMisses / (float)(end - begin);
+
+		clusters.push_back(begin);
+		cache.Reset();
+		unsigned int runningMisses = 0, runningTriangles = 0;
+		for (size_t t = begin; t < end; t++)
+		{
+			runningMisses += cache.Triangle(indices + t * 3);
+			runningTriangles++;
+			if (t + 1 < end && (float)runningMisses / (float)runningTriangles <= clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				cache.Reset();
+				runningMisses = runningTriangles = 0;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// sort key: how far the cluster sits out along its own average normal, measured from the mesh centroid
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		meshCentroid += vertices[indices[i]].Position;
+	meshCentroid /= (float)(triangleCount * 3);
+
+	size_t clusterCount = clusters.size() - 1;
+	vector<float> keys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3 + 0]].Position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float a = glm::length(n);
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+		centroid = area > 0.0f ? centroid / area : vertices[indices[clusters[c] * 3]].Position;
+		float length = glm::length(normal);
+		keys[c] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+	}
+
+	vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	for (size_t c : order)
+		result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	std::copy(result.begin(), result.end(), indices);
+}
+
+// ----- vertex fetch -----
+
+void OptimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	const unsigned int unused = ~0u;
+	vector<unsigned int> remap(vertices.size(), unused);
+	vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)result.size();
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(result);
+}
+
+void OptimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	// only whole triangles take part
+	indices.resize(indices.size() / 3 * 3);
+
+	OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+	OptimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size());
+	OptimizeVertexFetch(vertices, indices);
+}
+
+vector<Meshlet> BuildOptimizedMeshlets(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	vector<Meshlet> meshlets = BuildMeshlets(vertices.data(), vertices.size(), indices);
+
+	// gathering triangles into meshlets breaks up the cache order, restore it within each one.
+	// Each meshlet is optimized over its own few vertices so the cost doesn't scale with the whole mesh.
+	const unsigned int unused = ~0u;
+	vector<unsigned int> local(vertices.size(), unused);
+	vector<unsigned int> global;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		unsigned int* meshletIndices = &indices[meshlet.firstIndex];
+		global.clear();
+		for (size_t i = 0; i < meshlet.indexCount; ++i)
+		{
+			unsigned int& index = meshletIndices[i];
+			if (local[index] == unused)
+			{
+				local[index] = (unsigned int)global.size();
+				global.push_back(index);
+			}
+			index = local[index];
+		}
+
+		OptimizeVertexCache(meshletIndices, meshlet.indexCount, global.size());
+
+		for (size_t i = 0; i < meshlet.indexCount; ++i)
+			meshletIndices[i] = global[meshletIndices[i]];
+		for (unsigned int index : global)
+			local[index] = unused;
+	}
+	OptimizeVertexFetch(vertices, indices);
+	return meshlets;
+}
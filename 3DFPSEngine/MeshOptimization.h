@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+// Post-transform vertex cache statistics of an index buffer, from a FIFO cache simulation.
+struct VertexCacheStats {
+	float acmr = 0.0f;	// average cache misses per triangle, 0.5 is the ideal for a regular grid and 3 the worst case
+	float atvr = 0.0f;	// cache misses per referenced vertex, 1 is optimal
+};
+
+// default cache size used by the statistics, close to what desktop GPUs effectively provide
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// merges vertices whose attributes are bit identical, or with epsilon > 0 those that fall into the same epsilon sized
+// cell in every attribute, and remaps the indices. Fewer vertices mean fewer vertex shader invocations.
+void WeldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices, float epsilon = 0.0f);
+
+// reorders triangles for post-transform cache locality (Forsyth's linear speed vertex cache optimization)
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// reorders clusters of the cache optimized triangles so outward facing ones come first, reducing overdraw.
+// The cache efficiency may degrade by at most the given factor.
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f);
+
+// reorders vertices into first use order so fetches walk the buffer linearly, unreferenced vertices are dropped
+void OptimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+// all of the above, in order
+void OptimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+// groups the triangles of an optimized mesh into meshlets (BuildMeshlets), then restores the vertex cache order
+// within each meshlet and the fetch order. The meshlet ranges stay where BuildMeshlets put them.
+vector<Meshlet> BuildOptimizedMeshlets(vector<Vertex>& vertices, vector<unsigned int>& indices);
@@ -1,14 +1,46 @@
 #include "MeshRenderer.h"
 
+#include <algorithm>
+
 void MeshRenderer::Input(Transform transform) {}
 
 void MeshRenderer::Update(Transform transform) {}
 
 void MeshRenderer::Render(Transform transform)
 {
-	m_shader.use();
-	m_shader.setMat4("projection", transform.GetProjectionMatrix());
-	m_shader.setMat4("view", transform.GetViewMatrix());
-	m_shader.setMat4("model", transform.GetTransformation());
-	m_model.Draw(m_shader);
+	if (!m_model->IsResident())
+		return;
+
+	glm::mat4 projection = transform.GetProjectionMatrix();
+	glm::mat4 view = transform.GetViewMatrix();
+	glm::mat4 model = transform.GetTransformation();
+
+	// projected size of the bounding sphere decides the level of detail
+	glm::vec3 center = glm::vec3(view * model * glm::vec4(m_model->GetBoundingCenter(), 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float radius = m_model->GetBoundingRadius() * scale;
+	float distance = glm::length(center);
+	if (distance <= radius)
+		m_lod = 0;
+	else
+	{
+		float diameterPixels = radius * projection[1][1] / distance * (float)transform.GetViewportHeight();
+		m_lod = m_model->SelectLod(diameterPixels, m_lod);
+	}
+
+	MeshletCullView cull = MakeMeshletCullView(projection, view, model);
+
+	// models outside the frustum aren't queued at all, instanced draws don't cull meshlets
+	if (!IsSphereVisible(m_model->GetBoundingCenter(), m_model->GetBoundingRadius(), cull))
+		return;
+
+	// the screen density at the model's nearest point decides how many mip levels of its textures stream in
+	float nearest = std::max(distance - radius, 0.01f);
+	float pixelsPerUnit = 0.5f * projection[1][1] * (float)transform.GetViewportHeight() / nearest * scale;
+	m_model->RequestTextureDetail(pixelsPerUnit);
+
+	// drawn by RenderQueue::Submit once the whole scene is queued
+	uint32_t object = RenderQueue::Get().AddObject(model, Model::cullMeshlets ? &cull : nullptr);
+	for (Mesh& mesh : m_model->meshes)
+		RenderQueue::Get().Add(m_pass, m_shader, m_modelUniform, mesh, m_lod, object, distance);
 }
\ No newline at end of file
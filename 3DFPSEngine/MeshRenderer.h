@@ -1,15 +1,26 @@
 #pragma once
 #include "GameComponent.h"
 #include "Model.h"
+#include "RenderQueue.h"
+
+#include <memory>
 
 class MeshRenderer : public GameComponent
 {
 private:
-	Model m_model;
+	shared_ptr<Model> m_model;
 	Shader& m_shader;
+	unsigned int m_lod = 0;	// level drawn last frame, the selection is relative to it
+	Shader::Uniform m_modelUniform;	// view and projection come from the camera uniform buffer
+	RenderPass m_pass = RenderPass::Opaque;
 
 public:
-	MeshRenderer(const char* model_path, Shader& shader) : m_model(model_path), m_shader(shader) {}
+	MeshRenderer(const char* model_path, Shader& shader) : m_model(make_shared<Model>(model_path)), m_shader(shader), m_modelUniform(shader.GetUniform("model")) {}
+	// model may still be streaming in (see AssetStreamer), nothing is drawn until it is resident
+	MeshRenderer(shared_ptr<Model> model, Shader& shader) : m_model(model), m_shader(shader), m_modelUniform(shader.GetUniform("model")) {}
+
+	// transparent models are blended after the opaque ones, farthest first
+	void SetPass(RenderPass pass) { m_pass = pass; }
 
 	void Input(Transform transform);
 	void Update(Transform transform);
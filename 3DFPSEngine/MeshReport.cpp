@@ -0,0 +1,77 @@
+#include "MeshReport.h"
+
+#include "FileSystem.h"
+#include "MeshOptimization.h"
+#include "Model.h"
+
+#include <cstdio>
+
+int RunMeshReport(const std::string& directory)
+{
+	Assimp::Importer importer;
+	VertexCacheStats totalBefore, totalAfter;
+	size_t totalTriangles = 0, totalVerticesBefore = 0, totalVerticesAfter = 0, totalMeshlets = 0;
+
+	std::printf("%-48s %8s %26s %15s %15s %9s\n", "mesh", "tris", "verts (welded, index size)", "ACMR", "ATVR", "meshlets");
+	for (const std::string& path : ListFiles(directory))
+	{
+		std::string extension = GetExtension(path);
+		if (extension.empty() || !importer.IsExtensionSupported(extension.c_str()))
+			continue;
+
+		const aiScene* scene = importer.ReadFile(path, Model::IMPORT_FLAGS);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+		{
+			std::printf("%s: %s\n", path.c_str(), importer.GetErrorString());
+			continue;
+		}
+
+		for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+		{
+			const aiMesh* mesh = scene->mMeshes[m];
+
+			if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+				continue;
+
+			// same processing as Model::processMesh
+			vector<Vertex> vertices;
+			vector<unsigned int> indices;
+			Model::ReadGeometry(mesh, vertices, indices);
+			size_t importedVertices = vertices.size();
+
+			VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+			WeldVertices(vertices, indices, Model::weldEpsilon);
+			OptimizeMesh(vertices, indices);
+			vector<Meshlet> meshlets;
+			if (Model::buildMeshlets)
+				meshlets = BuildOptimizedMeshlets(vertices, indices);
+			VertexCacheStats after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+			std::string name = path + ":" + (mesh->mName.length ? mesh->mName.C_Str() : std::to_string(m));
+			std::printf("%-48s %8zu %6zu -> %6zu%s %6.3f -> %5.3f %6.3f -> %5.3f %9zu\n", name.c_str(), indices.size() / 3, importedVertices, vertices.size(),
+				ChooseIndexType(vertices.size()) == GL_UNSIGNED_SHORT ? " (16 bit)" : " (32 bit)", before.acmr, after.acmr, before.atvr, after.atvr, meshlets.size());
+			totalMeshlets += meshlets.size();
+			totalVerticesBefore += importedVertices;
+			totalVerticesAfter += vertices.size();
+
+			// triangle weighted totals
+			size_t triangles = indices.size() / 3;
+			totalBefore.acmr += before.acmr * triangles;
+			totalBefore.atvr += before.atvr * triangles;
+			totalAfter.acmr += after.acmr * triangles;
+			totalAfter.atvr += after.atvr * triangles;
+			totalTriangles += triangles;
+		}
+	}
+
+	if (totalTriangles == 0)
+	{
+		std::printf("no meshes found in %s\n", directory.c_str());
+		return 1;
+	}
+
+	std::printf("%-48s %8zu %6zu -> %6zu%9s %6.3f -> %5.3f %6.3f -> %5.3f %9zu\n", "total", totalTriangles, totalVerticesBefore, totalVerticesAfter, "",
+		totalBefore.acmr / totalTriangles, totalAfter.acmr / totalTriangles,
+		totalBefore.atvr / totalTriangles, totalAfter.atvr / totalTriangles, totalMeshlets);
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Imports every model file below the directory and prints, for each mesh, the vertex count before and after welding
+// and the vertex cache statistics (ACMR/ATVR) in Assimp's order and after optimization. Run with --mesh-report [directory].
+int RunMeshReport(const std::string& directory);
@@ -0,0 +1,319 @@
+#include "MeshSimplification.h"
+
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// symmetric 4x4 matrix of the sum of squared distances to a set of planes
+struct Quadric {
+	double a2 = 0, ab = 0, ac = 0, ad = 0;
+	double b2 = 0, bc = 0, bd = 0;
+	double c2 = 0, cd = 0;
+	double d2 = 0;
+
+	void AddPlane(double a, double b, double c, double d)
+	{
+		a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+		b2 += b * b; bc += b * c; bd += b * d;
+		c2 += c * c; cd += c * d;
+		d2 += d * d;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double Evaluate(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = a2 * x * x + b2 * y * y + c2 * z * z + 2 * (ab * x * y + ac * x * z + bc * y * z) + 2 * (ad * x + bd * y + cd * z) + d2;
+		return std::max(error, 0.0);
+	}
+};
+
+struct Collapse {
+	double cost;
+	unsigned int from;
+	unsigned int to;
+};
+
+static uint64_t EdgeKey(unsigned int a, unsigned int b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static glm::vec3 TriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	return glm::cross(p1 - p0, p2 - p0);
+}
+
+// triangles around 'from' that don't contain 'to' must not turn over when 'from' moves onto 'to'
+static bool CollapseFlips(const Vertex* vertices, const unsigned int* indices, const unsigned int* triangles, size_t count, unsigned int from, unsigned int to)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned int* triangle = indices + triangles[i] * 3;
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		glm::vec3 p[3], q[3];
+		for (int k = 0; k < 3; k++)
+		{
+			p[k] = vertices[triangle[k]].Position;
+			q[k] = triangle[k] == from ? vertices[to].Position : p[k];
+		}
+		glm::vec3 before = TriangleNormal(p[0], p[1], p[2]);
+		glm::vec3 after = TriangleNormal(q[0], q[1], q[2]);
+		// reject anything turning by more than about 75 degrees
+		if (glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after))
+			return true;
+	}
+	return false;
+}
+
+static void RemoveDegenerateTriangles(vector<unsigned int>& indices)
+{
+	size_t write = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (a == b || b == c || a == c)
+			continue;
+		indices[write++] = a;
+		indices[write++] = b;
+		indices[write++] = c;
+	}
+	indices.resize(write);
+}
+
+vector<unsigned int> SimplifyMesh(const Vertex* vertices, size_t vertexCount, const vector<unsigned int>& indices,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	vector<unsigned int> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+	double maxError = 0.0;
+
+	// plane quadrics of the faces around each vertex
+	vector<Quadric> quadrics(vertexCount);
+	std::unordered_map<uint64_t, unsigned int> edgeUse;
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const unsigned int* triangle = &result[i];
+		glm::vec3 normal = TriangleNormal(vertices[triangle[0]].Position, vertices[triangle[1]].Position, vertices[triangle[2]].Position);
+		float length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normal /= length;
+			double d = -glm::dot(normal, vertices[triangle[0]].Position);
+			for (int k = 0; k < 3; k++)
+				quadrics[triangle[k]].AddPlane(normal.x, normal.y, normal.z, d);
+		}
+		for (int k = 0; k < 3; k++)
+			edgeUse[EdgeKey(triangle[k], triangle[(k + 1) % 3])]++;
+	}
+
+	// an edge without exactly two triangles is a border, a seam (the other side uses different vertices) or
+	// non-manifold. Its vertices stay where they are so the outline and the attribute seams don't tear.
+	vector<bool> locked(vertexCount, false);
+	for (const auto& edge : edgeUse)
+	{
+		if (edge.second != 2)
+		{
+			locked[(unsigned int)(edge.first >> 32)] = true;
+			locked[(unsigned int)(edge.first & 0xffffffff)] = true;
+		}
+	}
+
+	double errorLimit = (double)targetError * targetError;
+	vector<unsigned int> remap(vertexCount);
+	vector<unsigned int> offsets(vertexCount + 1), adjacency, fill;
+	vector<bool> touched(vertexCount);
+	vector<Collapse> collapses;
+
+	// collapse in passes, each vertex takes part in at most one collapse per pass so the checks stay valid
+	while (result.size() > targetIndexCount)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (unsigned int index : result)
+			offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			offsets[v + 1] += offsets[v];
+		adjacency.resize(result.size());
+		fill.assign(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			unsigned int from = result[i];
+			unsigned int to = result[i % 3 == 2 ? i - 2 : i + 1];
+			if (!locked[from])
+				collapses.push_back({ 0.0, from, to });
+			if (!locked[to])
+				collapses.push_back({ 0.0, to, from });
+		}
+		for (Collapse& collapse : collapses)
+		{
+			Quadric q = quadrics[collapse.from];
+			q.Add(quadrics[collapse.to]);
+			collapse.cost = q.Evaluate(vertices[collapse.to].Position);
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t triangles = result.size() / 3, targetTriangles = targetIndexCount / 3, removed = 0, performed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.cost > errorLimit || triangles - removed <= targetTriangles)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			const unsigned int* around = &adjacency[offsets[collapse.from]];
+			size_t count = offsets[collapse.from + 1] - offsets[collapse.from];
+			if (CollapseFlips(vertices, result.data(), around, count, collapse.from, collapse.to))
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			maxError = std::max(maxError, collapse.cost);
+			performed++;
+
+			// the neighbourhood changes shape, leave it alone for the rest of the pass
+			for (size_t t = 0; t < count; t++)
+			{
+				const unsigned int* triangle = &result[around[t] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					removed++;
+				for (int k = 0; k < 3; k++)
+					touched[triangle[k]] = true;
+			}
+		}
+
+		if (performed == 0)
+			break;
+
+		for (unsigned int& index : result)
+			index = remap[index];
+		RemoveDegenerateTriangles(result);
+	}
+
+	if (resultError)
+		*resultError = (float)std::sqrt(maxError);
+	return result;
+}
+
+// clusters the referenced vertices into cells of the given size, the first vertex in each cell represents it.
+// origin is the corner of the bounds, so cell coordinates start at 0.
+static vector<unsigned int> ClusterVertices(const Vertex* vertices, const vector<unsigned int>& indices, const glm::vec3& origin, float cellSize)
+{
+	// 21 bits per axis in disjoint ranges of the key, so two cells never share one. The grid is at most 1024 cells
+	// across, clamping only catches rounding at the edges.
+	const float CELL_LIMIT = (float)((1 << 21) - 1);
+	std::unordered_map<uint64_t, unsigned int> cells;
+	vector<unsigned int> result(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		glm::vec3 cell = glm::clamp(glm::floor((vertices[indices[i]].Position - origin) / cellSize), glm::vec3(0.0f), glm::vec3(CELL_LIMIT));
+		uint64_t key = (uint64_t)cell.x | (uint64_t)cell.y << 21 | (uint64_t)cell.z << 42;
+		auto inserted = cells.insert(std::make_pair(key, indices[i]));
+		result[i] = inserted.first->second;
+	}
+	RemoveDegenerateTriangles(result);
+	return result;
+}
+
+vector<unsigned int> SimplifyMeshSloppy(const Vertex* vertices, size_t vertexCount, const vector<unsigned int>& indices,
+	size_t targetIndexCount, float* resultError)
+{
+	vector<unsigned int> source(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+	if (resultError)
+		*resultError = 0.0f;
+	if (source.empty() || vertexCount == 0)
+		return source;
+
+	glm::vec3 boundsMin = vertices[source[0]].Position, boundsMax = boundsMin;
+	for (unsigned int index : source)
+	{
+		boundsMin = glm::min(boundsMin, vertices[index].Position);
+		boundsMax = glm::max(boundsMax, vertices[index].Position);
+	}
+	float extent = std::max(boundsMax.x - boundsMin.x, std::max(boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+	if (extent <= 0.0f)
+		return source;
+
+	// finest grid that still meets the target, the triangle count grows with the grid resolution
+	int low = 1, high = 1024;
+	vector<unsigned int> best = ClusterVertices(vertices, source, boundsMin, extent);
+	float bestCell = extent;
+	while (low < high)
+	{
+		int middle = (low + high + 1) / 2;
+		float cellSize = extent / middle;
+		vector<unsigned int> clustered = ClusterVertices(vertices, source, boundsMin, cellSize);
+		if (clustered.size() <= targetIndexCount)
+		{
+			best.swap(clustered);
+			bestCell = cellSize;
+			low = middle;
+		}
+		else
+			high = middle - 1;
+	}
+
+	if (resultError)
+		*resultError = bestCell * std::sqrt(3.0f);
+	return best;
+}
+
+vector<LodLevel> GenerateLodChain(const vector<Vertex>& vertices, const vector<unsigned int>& indices, unsigned int maxLevels)
+{
+	vector<LodLevel> levels;
+	if (vertices.empty() || indices.size() < 3)
+		return levels;
+
+	glm::vec3 boundsMin = vertices[0].Position, boundsMax = boundsMin;
+	for (const Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.Position);
+		boundsMax = glm::max(boundsMax, vertex.Position);
+	}
+	// the edge collapse may move the surface by a few percent of the mesh size before clustering takes over
+	float errorLimit = glm::length(boundsMax - boundsMin) * 0.05f;
+
+	const vector<unsigned int>* previous = &indices;
+	float previousError = 0.0f;
+	for (unsigned int level = 0; level < maxLevels; level++)
+	{
+		size_t target = previous->size() / 6 * 3;
+		if (target < 3)
+			break;
+
+		LodLevel lod;
+		lod.indices = SimplifyMesh(vertices.data(), vertices.size(), *previous, target, errorLimit, &lod.error);
+		if (lod.indices.size() > target + target / 4)
+			lod.indices = SimplifyMeshSloppy(vertices.data(), vertices.size(), *previous, target, &lod.error);
+
+		// not worth a level of its own
+		if (lod.indices.empty() || lod.indices.size() * 10 > previous->size() * 8)
+			break;
+
+		// errors add up since every level starts from the one before
+		lod.error += previousError;
+		previousError = lod.error;
+
+		OptimizeVertexCache(lod.indices.data(), lod.indices.size(), vertices.size());
+		levels.push_back(std::move(lod));
+		previous = &levels.back().indices;
+	}
+	return levels;
+}
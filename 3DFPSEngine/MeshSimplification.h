@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <vector>
+
+// One simplified version of a mesh. It indexes the same vertex buffer as the full detail mesh, so a LOD
+// only costs an extra index range.
+struct LodLevel {
+	std::vector<unsigned int> indices;
+	float error = 0.0f;	// how far, in object space units, the surface may have moved from the full detail mesh
+};
+
+// Quadric error metric edge collapse. Vertices collapse onto a neighbour (nothing is moved, so all attributes stay
+// valid) in order of increasing error until the index count reaches the target or the next collapse would exceed
+// targetError. Vertices on borders and attribute seams stay put. resultError receives the largest error introduced.
+std::vector<unsigned int> SimplifyMesh(const Vertex* vertices, size_t vertexCount, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float targetError, float* resultError);
+
+// Vertex clustering on a uniform grid sized to hit the target. Ignores topology and seams, so it always gets there,
+// meant for far away levels where SimplifyMesh gets stuck on locked vertices.
+std::vector<unsigned int> SimplifyMeshSloppy(const Vertex* vertices, size_t vertexCount, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float* resultError);
+
+// Builds up to maxLevels LODs below the full detail mesh, each with about half the triangles of the one before,
+// stopping early once a level no longer gets meaningfully smaller. The index orders are vertex cache optimized.
+std::vector<LodLevel> GenerateLodChain(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int maxLevels = 4);
@@ -0,0 +1,277 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+// smallest sphere around the points found by Ritter's method, within a few percent of the optimal one
+static void BoundingSphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius)
+{
+	// start from the pair of extreme points along the axis where they are furthest apart
+	size_t minIndex[3] = { 0, 0, 0 }, maxIndex[3] = { 0, 0, 0 };
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (points[i][axis] < points[minIndex[axis]][axis])
+				minIndex[axis] = i;
+			if (points[i][axis] > points[maxIndex[axis]][axis])
+				maxIndex[axis] = i;
+		}
+	}
+	int widest = 0;
+	float widestSpan = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float span = glm::length(points[maxIndex[axis]] - points[minIndex[axis]]);
+		if (span > widestSpan)
+		{
+			widestSpan = span;
+			widest = axis;
+		}
+	}
+
+	center = (points[minIndex[widest]] + points[maxIndex[widest]]) * 0.5f;
+	radius = widestSpan * 0.5f;
+
+	// grow it over every point still outside
+	for (const glm::vec3& point : points)
+	{
+		float distance = glm::length(point - center);
+		if (distance > radius)
+		{
+			float grown = (radius + distance) * 0.5f;
+			center += (point - center) * ((grown - radius) / distance);
+			radius = grown;
+		}
+	}
+}
+
+static void ComputeBounds(const Vertex* vertices, const unsigned int* indices, size_t indexCount, Meshlet& meshlet)
+{
+	std::vector<glm::vec3> corners(indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+		corners[i] = vertices[indices[i]].Position;
+	BoundingSphere(corners, meshlet.center, meshlet.radius);
+
+	// the cone axis is the mean of the face normals, the cone has to cover the one furthest from it
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> origins;	// a corner of each triangle, for the apex below
+	glm::vec3 sum(0.0f);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec3 normal = glm::cross(corners[i + 1] - corners[i], corners[i + 2] - corners[i]);
+		float length = glm::length(normal);
+		// degenerate triangles don't face anywhere
+		if (length <= 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		origins.push_back(corners[i]);
+		sum += normals.back();
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	float sumLength = glm::length(sum);
+	if (normals.empty() || sumLength <= 0.0f)
+		return;
+
+	glm::vec3 axis = sum / sumLength;
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+		minDot = std::min(minDot, glm::dot(normal, axis));
+
+	// normals spread close to or past 90 degrees leave almost no direction the whole cluster faces away from
+	if (minDot <= 0.1f)
+		return;
+
+	// move the apex back along the axis until it lies behind every triangle's plane, then any eye further back
+	// inside the cone is behind all of them too
+	float back = 0.0f;
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		float distance = glm::dot(meshlet.center - origins[i], normals[i]) / glm::dot(axis, normals[i]);
+		back = std::max(back, distance);
+	}
+
+	// the cluster is backfacing from directions within 90 degrees minus the normals' spread of the axis,
+	// so the cutoff is cos(90 - spread) = sin(spread)
+	meshlet.coneApex = meshlet.center - axis * back;
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> BuildMeshlets(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& indices,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || maxVertices < 3 || maxTriangles < 1)
+		return meshlets;
+
+	// triangles around each vertex, as offsets into one shared array
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int index : indices)
+		adjacencyOffsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	// unassigned triangles left around each vertex
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> slot(vertexCount, ~0u);	// meshlet that last used the vertex
+	std::vector<unsigned int> reordered;
+	reordered.reserve(indices.size());
+
+	std::vector<unsigned int> meshletVertices;
+	glm::vec3 centroidSum(0.0f);
+	unsigned int meshletTriangles = 0;
+	unsigned int meshletId = 0;
+	size_t seed = 0;	// earliest triangle in the input order that may still be unassigned
+
+	auto newVertices = [&](size_t t)
+	{
+		unsigned int count = 0;
+		for (int k = 0; k < 3; k++)
+			count += slot[indices[t * 3 + k]] != meshletId;
+		return count;
+	};
+
+	auto finishMeshlet = [&]()
+	{
+		Meshlet meshlet;
+		meshlet.indexCount = meshletTriangles * 3;
+		meshlet.firstIndex = (unsigned int)(reordered.size() - meshlet.indexCount);
+		ComputeBounds(vertices, &reordered[meshlet.firstIndex], meshlet.indexCount, meshlet);
+		meshlets.push_back(meshlet);
+		meshletVertices.clear();
+		centroidSum = glm::vec3(0.0f);
+		meshletTriangles = 0;
+		meshletId++;
+	};
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (meshletTriangles == maxTriangles)
+			finishMeshlet();
+
+		// best neighbour of the current meshlet: one that closes a gap (no new vertices) or completes a vertex's
+		// fan, otherwise the one closest to the meshlet's centre so it grows round instead of into a strip
+		size_t best = triangleCount;
+		unsigned int bestNew = 4;
+		float bestDistance = 0.0f;
+		glm::vec3 centroid = meshletVertices.empty() ? glm::vec3(0.0f) : centroidSum / (float)meshletVertices.size();
+		for (unsigned int v : meshletVertices)
+		{
+			for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+			{
+				unsigned int t = adjacency[a];
+				if (emitted[t])
+					continue;
+				unsigned int added = newVertices(t);
+				if (meshletVertices.size() + added > maxVertices)
+					continue;
+				bool finishesFan = liveTriangles[indices[t * 3]] == 1 || liveTriangles[indices[t * 3 + 1]] == 1 || liveTriangles[indices[t * 3 + 2]] == 1;
+				unsigned int priority = added == 0 || finishesFan ? 0 : added;
+				glm::vec3 triangleCenter = (vertices[indices[t * 3]].Position + vertices[indices[t * 3 + 1]].Position + vertices[indices[t * 3 + 2]].Position) / 3.0f;
+				glm::vec3 offset = triangleCenter - centroid;
+				float distance = glm::dot(offset, offset);
+				if (priority < bestNew || (priority == bestNew && (distance < bestDistance || (distance == bestDistance && t < best))))
+				{
+					best = t;
+					bestNew = priority;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		// nothing connected fits: close the meshlet unless it is empty, and continue in the input order, which the
+		// cache optimization left spatially coherent
+		if (best == triangleCount)
+		{
+			if (meshletTriangles > 0)
+				finishMeshlet();
+			while (emitted[seed])
+				seed++;
+			best = seed;
+		}
+
+		emitted[best] = true;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[best * 3 + k];
+			reordered.push_back(v);
+			liveTriangles[v]--;
+			if (slot[v] != meshletId)
+			{
+				slot[v] = meshletId;
+				meshletVertices.push_back(v);
+				centroidSum += vertices[v].Position;
+			}
+		}
+		meshletTriangles++;
+	}
+	if (meshletTriangles > 0)
+		finishMeshlet();
+
+	indices.swap(reordered);
+	return meshlets;
+}
+
+MeshletCullView MakeMeshletCullView(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model)
+{
+	MeshletCullView cull;
+
+	// Gribb/Hartmann: the clip space planes pulled back through the whole transform land in object space
+	glm::mat4 transform = projection * view * model;
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(transform[0][r], transform[1][r], transform[2][r], transform[3][r]);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cull.planes[axis * 2] = rows[3] + rows[axis];
+		cull.planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+	for (glm::vec4& plane : cull.planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane /= length;
+	}
+
+	// cone culling needs a point the camera looks from and normals that keep facing the same way
+	glm::mat4 modelView = view * model;
+	cull.eye = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	cull.testCones = projection[2][3] != 0.0f && glm::determinant(glm::mat3(modelView)) > 0.0f;
+	return cull;
+}
+
+bool IsSphereVisible(const glm::vec3& center, float radius, const MeshletCullView& view)
+{
+	for (const glm::vec4& plane : view.planes)
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	return true;
+}
+
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullView& view)
+{
+	if (!IsSphereVisible(meshlet.center, meshlet.radius, view))
+		return false;
+
+	if (view.testCones && meshlet.coneCutoff < 1.0f)
+	{
+		glm::vec3 offset = meshlet.coneApex - view.eye;
+		float distance = glm::length(offset);
+		if (distance > 0.0f && glm::dot(offset, meshlet.coneAxis) >= meshlet.coneCutoff * distance)
+			return false;
+	}
+	return true;
+}
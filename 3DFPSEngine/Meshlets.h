@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Small cluster of a mesh's triangles: a contiguous range of its full detail index list, with bounds for culling
+// the whole cluster at once before it is submitted.
+struct Meshlet {
+	unsigned int firstIndex = 0;	// into the mesh's indices
+	unsigned int indexCount = 0;
+	glm::vec3 center = glm::vec3(0.0f);	// bounding sphere, object space
+	float radius = 0.0f;
+	// every triangle faces away from an eye at e when dot(normalize(coneApex - e), coneAxis) >= coneCutoff.
+	// coneCutoff is 1 when the normals spread too far for that to ever hold.
+	glm::vec3 coneApex = glm::vec3(0.0f);
+	glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float coneCutoff = 1.0f;
+};
+
+// sizes that map well onto GPU wave sizes, see BuildMeshlets
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// Groups the triangles into meshlets of at most maxVertices distinct vertices and maxTriangles triangles and
+// reorders the index list so every meshlet is one range of it. Triangles are added to the current meshlet by
+// adjacency, preferring those that bring in the fewest new vertices, which keeps meshlets compact and their normal
+// cones narrow. Meshes go through BuildOptimizedMeshlets (MeshOptimization.h), which restores the cache order after.
+std::vector<Meshlet> BuildMeshlets(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& indices,
+	unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// The camera as seen from a mesh's object space, for culling its meshlets.
+struct MeshletCullView {
+	glm::vec4 planes[6];	// frustum planes, normalized, inside is dot(plane.xyz, p) + plane.w >= 0
+	glm::vec3 eye;			// camera position
+	bool testCones;			// off under a projection without a single eye position or a mirroring transform
+};
+
+MeshletCullView MakeMeshletCullView(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model);
+
+// false if the sphere is entirely outside one of the frustum planes
+bool IsSphereVisible(const glm::vec3& center, float radius, const MeshletCullView& view);
+// false if the meshlet is outside the frustum or faces away from the eye entirely
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullView& view);
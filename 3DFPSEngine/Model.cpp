@@ -1,42 +1,21 @@
 #include "Model.h"
-#include <stb_image.h>
 
-unsigned int Model::TextureFromFile(const char *path, const string &directory, bool gamma)
+bool Model::quantizeVertices = true;
+float Model::weldEpsilon = 0.0f;
+bool Model::useSharedArena = false;
+bool Model::generateLods = true;
+float Model::lodPixelError = 1.0f;
+bool Model::buildMeshlets = true;
+bool Model::cullMeshlets = true;
+
+Texture Model::loadTexture(const char *path, string const &typeName, string const &directory)
 {
 	string filename = string(path);
 	filename = directory + '/' + filename;
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	GLenum format = NULL;
-	unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
+	Texture texture;
+	texture.handle = TextureCache::Get().Acquire(filename);
+	texture.type = typeName;
+	texture.path = path;
+	return texture;
 }
\ No newline at end of file
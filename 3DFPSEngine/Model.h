@@ -10,86 +10,369 @@
 #include <assimp/postprocess.h>
 
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
+#include "VertexQuantization.h"
+#include "Hash.h"
+#include "PakIOSystem.h"
+#include "Profiler.h"
+#include "CookManifest.h"
+#include "FileSystem.h"
 #include "Shader.h"
+#include "TextureCache.h"
 
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 using namespace std;
 
+// Everything loaded for a model before any GL call is made, can be produced on any thread.
+struct ModelData {
+	string directory;
+	bool acquireTextures = true;			// false when only cooking, textures are then listed by path without loading them
+	MeshCache cache;						// maps the baked arrays when loaded from the cache...
+	vector<vector<Vertex>> vertexArrays;	// ...otherwise these hold the arrays built from the ASSIMP scene
+	vector<vector<unsigned int>> indexArrays;
+	vector<vector<uint16_t>> shortIndexArrays;	// 16 bit copies of indexArrays for meshes that allow it
+	vector<vector<vector<unsigned int>>> lodArrays;	// per mesh, the index lists of its coarser levels
+	vector<vector<vector<uint16_t>>> shortLodArrays;
+	vector<vector<PackedVertex>> packedArrays;	// quantized copies of vertexArrays when the packed layout is used
+	vector<MeshData> meshes;				// points into one of the above
+};
+
 class Model
 {
 public:
 	/*  Model Data */
-	vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
 	vector<Mesh> meshes;
 	string directory;
 	bool gammaCorrection;
+	CPUDataPolicy cpuDataPolicy = CPUDataPolicy::Release;	// whether meshes keep float vertices and indices after upload
+
+	// post processing applied on import, part of the baked cache key so changing it forces a rebuild
+	static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+	// store and upload vertices in the 20 byte PackedVertex layout instead of 56 bytes of floats
+	static bool quantizeVertices;
+	// vertices whose attributes all lie within this distance are merged on import, 0 only merges exact duplicates
+	static float weldEpsilon;
+	// put the geometry of every model into the process wide arena instead of one arena per model. Only for models
+	// that stay loaded, the shared arena never frees, so hot reload (AssetStreamer::ReloadFile) skips them.
+	// Models loaded while it is off get arenas of their own and stay reloadable.
+	static bool useSharedArena;
+	// build a chain of simplified LODs per mesh on import
+	static bool generateLods;
+	// how many pixels a LOD's error may cover on screen before the next finer level is used
+	static float lodPixelError;
+	// split each mesh into meshlets on import (see BuildMeshlets), so partly visible meshes can skip clusters
+	static bool buildMeshlets;
+	// skip meshlets outside the frustum or facing away from the camera when drawing the full detail level.
+	// Backfacing clusters of closed meshes are hidden by their front anyway, open single sided surfaces may lose
+	// their back side.
+	static bool cullMeshlets;
 
 	/*  Functions   */
-	// constructor, expects a filepath to a 3D model.
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	// constructor, expects a filepath to a 3D model. Blocks until the model is resident.
+	Model(string const &path, bool gamma = false, CPUDataPolicy policy = CPUDataPolicy::Release) : gammaCorrection(gamma), cpuDataPolicy(policy)
+	{
+		unique_ptr<ModelData> data = LoadData(path);
+		for (size_t i = 0; i < data->meshes.size(); i++)
+			UploadMesh(*data, i);
+
+		// the texture decodes ran on the thread pool while the meshes were processed, upload them now. Only this
+		// model's, loads other models started keep streaming.
+		vector<TextureHandle> textures;
+		for (const Mesh& mesh : meshes)
+			for (const Texture& texture : mesh.textures)
+				if (texture.handle)
+					textures.push_back(texture.handle);
+		TextureCache::Get().FinishLoads(textures);
+	}
+
+	// empty model, filled in over the following frames by the AssetStreamer
+	Model(CPUDataPolicy policy = CPUDataPolicy::Release) : gammaCorrection(false), cpuDataPolicy(policy) {}
+
+	// frees the CPU copies kept under CPUDataPolicy::Keep once nothing needs them anymore
+	void ReleaseCPUData()
+	{
+		for (Mesh& mesh : meshes)
+			mesh.ReleaseCPUData();
+		cpuDataPolicy = CPUDataPolicy::Release;
+	}
+
+	// bytes held by the meshes' CPU copies
+	size_t GetCPUDataSize() const
 	{
-		loadModel(path);
+		size_t bytes = 0;
+		for (const Mesh& mesh : meshes)
+			bytes += mesh.GetCPUDataSize();
+		return bytes;
+	}
+
+	// levels available, the full detail one included
+	unsigned int GetLodCount() const
+	{
+		unsigned int count = 1;
+		for (const Mesh& mesh : meshes)
+			count = std::max(count, mesh.GetLodCount());
+		return count;
+	}
+
+	// worst error of any mesh drawn at the given level
+	float GetLodError(unsigned int lod) const
+	{
+		float error = 0.0f;
+		for (const Mesh& mesh : meshes)
+			if (lod > 0 && !mesh.lods.empty())
+				error = std::max(error, mesh.lods[std::min(lod, (unsigned int)mesh.lods.size()) - 1].error);
+		return error;
+	}
+
+	// object space bounding sphere of all meshes
+	glm::vec3 GetBoundingCenter() const { return boundingCenter; }
+	float GetBoundingRadius() const { return boundingRadius; }
+
+	// picks the coarsest level whose error stays under lodPixelError pixels when the bounding sphere covers
+	// diameterPixels on screen. Equivalently, level l is used while the sphere is smaller than
+	// 2 * radius * lodPixelError / error(l) pixels. Switching to a coarser level than 'current' needs a margin,
+	// and so does switching back, so objects near a threshold don't flicker between levels.
+	unsigned int SelectLod(float diameterPixels, unsigned int current) const
+	{
+		const float HYSTERESIS = 0.2f;
+		if (boundingRadius <= 0.0f)
+			return 0;
+
+		float pixelsPerUnit = diameterPixels / (2.0f * boundingRadius);
+		unsigned int lod = 0;
+		for (unsigned int l = 1; l < GetLodCount(); l++)
+		{
+			float allowed = lodPixelError * (l > current ? 1.0f - HYSTERESIS : 1.0f + HYSTERESIS);
+			if (GetLodError(l) * pixelsPerUnit <= allowed)
+				lod = l;
+		}
+		return lod;
 	}
 
-	// draws the model, and thus all its meshes
-	void Draw(Shader shader)
+	// draws the model, and thus all its meshes. cull is the camera in the model's object space, for meshlet culling.
+	void Draw(Shader &shader, unsigned int lod = 0, const MeshletCullView* cull = nullptr)
 	{
+		// all meshes normally share one arena, so this binds a single VAO
+		unsigned int boundVAO = 0;
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
+		{
+			if (meshes[i].arena->GetVAO() != boundVAO)
+			{
+				meshes[i].arena->Bind();
+				boundVAO = meshes[i].arena->GetVAO();
+			}
+			meshes[i].DrawBound(shader, lod, cull);
+		}
 	}
 
-private:
-	/*  Functions   */
-	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-	void loadModel(string const &path)
+	// tells the texture cache the model is visible with pixelsPerUnit screen pixels per object space unit at its
+	// nearest point, so its textures stream in the mip levels that density needs
+	void RequestTextureDetail(float pixelsPerUnit)
+	{
+		for (const Mesh& mesh : meshes)
+			for (const Texture& texture : mesh.textures)
+				if (texture.handle)
+					TextureCache::Get().RequestDetail(texture.handle, pixelsPerUnit * mesh.uvDensity);
+	}
+
+	// whether the geometry went into the process wide arena, where it can never be freed
+	bool IsInSharedArena() const { return sharedArena; }
+
+	// true once every mesh and texture of the model has been uploaded
+	bool IsResident()
+	{
+		if (!meshesUploaded)
+			return false;
+		if (resident)
+			return true;
+
+		for (const Mesh& mesh : meshes)
+			for (const Texture& texture : mesh.textures)
+				if (texture.handle && !texture.handle->IsResident())
+					return false;
+		resident = true;
+		return true;
+	}
+
+	// the material libraries an .obj names on its 'mtllib' lines, relative to the model. The importer reads them
+	// along with the model, so they are part of its source.
+	static vector<string> GetMaterialLibraries(string const &path, const AssetFile &source)
+	{
+		vector<string> libraries;
+		if (GetExtension(path) != ".obj" || !source.IsOpen())
+			return libraries;
+
+		string directory = path.substr(0, path.find_last_of('/'));
+		const char* text = reinterpret_cast<const char*>(source.Data());
+		size_t size = source.Size();
+		for (size_t start = 0; start < size;)
+		{
+			const char* newline = static_cast<const char*>(memchr(text + start, '\n', size - start));
+			size_t end = newline ? (size_t)(newline - text) : size;
+			// the rest of the line is the file name, which may contain spaces
+			if (end - start > 7 && memcmp(text + start, "mtllib ", 7) == 0)
+			{
+				string name(text + start + 7, end - start - 7);
+				size_t first = name.find_first_not_of(" \t");
+				size_t last = name.find_last_not_of(" \t\r");
+				if (first != string::npos)
+					libraries.push_back(directory + "/" + name.substr(first, last - first + 1));
+			}
+			start = end + 1;
+		}
+		return libraries;
+	}
+
+	// hash of the source file, its material libraries and the import settings, edits to any of them invalidate
+	// the baked cache
+	static uint64_t ComputeSourceHash(string const &path)
+	{
+		uint64_t sourceHash = 0;
+		AssetFile source;
+		if (source.Open(path))
+			sourceHash = HashBytes(source.Data(), source.Size());
+		for (const string& library : GetMaterialLibraries(path, source))
+		{
+			AssetFile material;
+			if (material.Open(library))
+				sourceHash = HashBytes(material.Data(), material.Size(), sourceHash);
+			else
+				sourceHash = HashBytes("missing", 7, sourceHash);
+		}
+		source.Close();
+		// the import settings change the baked data too
+		sourceHash = HashBytes(&weldEpsilon, sizeof(weldEpsilon), sourceHash);
+		sourceHash = HashBytes(&generateLods, sizeof(generateLods), sourceHash);
+		sourceHash = HashBytes(&buildMeshlets, sizeof(buildMeshlets), sourceHash);
+		return sourceHash;
+	}
+
+	static VertexFormat GetVertexFormat() { return quantizeVertices ? VertexFormat::Packed : VertexFormat::Float; }
+
+	// loads a model, from the baked mesh cache if it is up to date and otherwise with ASSIMP (rebuilding the cache afterwards).
+	// With CookManifest::cookedOnly set only the cooked output is read. Makes no GL calls so it can run on any thread,
+	// the texture decodes are queued on the thread pool as they are found.
+	static unique_ptr<ModelData> LoadData(string const &path)
+	{
+		ProfileScope scope("model", path);
+		unique_ptr<ModelData> data(new ModelData());
+		// retrieve the directory path of the filepath
+		data->directory = path.substr(0, path.find_last_of('/'));
+
+		VertexFormat format = GetVertexFormat();
+		if (CookManifest::cookedOnly)
+		{
+			CookManifest::Entry cooked;
+			if (!CookManifest::Get().Find(path, cooked) || !data->cache.Open(cooked.path, cooked.key, IMPORT_FLAGS, format))
+			{
+				cout << "ERROR::MODEL::NOT_COOKED " << path << endl;
+				return data;
+			}
+			useCachedMeshes(*data);
+			return data;
+		}
+
+		uint64_t sourceHash = ComputeSourceHash(path);
+		string cachePath = MeshCache::GetCachePath(path);
+		if (data->cache.Open(cachePath, sourceHash, IMPORT_FLAGS, format))
+		{
+			useCachedMeshes(*data);
+			return data;
+		}
+
+		if (!ImportData(path, *data))
+			return data;
+
+		// bake the result so the next start can skip ASSIMP
+		ProfileScope bake("bake", path);
+		MeshCache::Write(cachePath, sourceHash, IMPORT_FLAGS, format, data->meshes);
+
+		return data;
+	}
+
+	// imports the model with ASSIMP and runs the mesh processing (welding, optimization, LODs, quantization) into data,
+	// the same arrays the baked cache stores. data.directory must be set. Returns false if ASSIMP fails.
+	static bool ImportData(string const &path, ModelData &data)
 	{
 		// read file via ASSIMP
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		// the model and its material libraries may live in the pak
+		importer.SetIOHandler(new PakIOSystem());
+		const aiScene* scene;
+		{
+			ProfileScope parse("assimp", path);
+			scene = importer.ReadFile(path, IMPORT_FLAGS);
+		}
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-			return;
+			return false;
 		}
-		// retrieve the directory path of the filepath
-		directory = path.substr(0, path.find_last_of('/'));
 
 		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
-	}
+		processNode(scene->mRootNode, scene, data);
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode *node, const aiScene *scene)
-	{
-		// process each mesh located at the current node
-		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		// now that the arrays won't move anymore, point the meshes at them
+		data.shortIndexArrays.resize(data.meshes.size());
+		data.shortLodArrays.resize(data.meshes.size());
+		for (size_t i = 0; i < data.meshes.size(); i++)
 		{
-			// the node object only contains indices to index the actual objects in the scene. 
-			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			MeshData& mesh = data.meshes[i];
+			mesh.vertices = data.vertexArrays[i].data();
+			mesh.indexType = ChooseIndexType(mesh.numVertices);
+			if (mesh.indexType == GL_UNSIGNED_SHORT)
+			{
+				data.shortIndexArrays[i].assign(data.indexArrays[i].begin(), data.indexArrays[i].end());
+				mesh.indices = data.shortIndexArrays[i].data();
+			}
+			else
+				mesh.indices = data.indexArrays[i].data();
+
+			vector<vector<unsigned int>>& lods = data.lodArrays[i];
+			if (mesh.indexType == GL_UNSIGNED_SHORT)
+				data.shortLodArrays[i].resize(lods.size());
+			for (size_t l = 0; l < lods.size(); l++)
+			{
+				if (mesh.indexType == GL_UNSIGNED_SHORT)
+				{
+					data.shortLodArrays[i][l].assign(lods[l].begin(), lods[l].end());
+					mesh.lods[l].indices = data.shortLodArrays[i][l].data();
+				}
+				else
+					mesh.lods[l].indices = lods[l].data();
+			}
 		}
-		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-		for (unsigned int i = 0; i < node->mNumChildren; i++)
+
+		if (GetVertexFormat() == VertexFormat::Packed)
 		{
-			processNode(node->mChildren[i], scene);
+			data.packedArrays.resize(data.meshes.size());
+			for (size_t i = 0; i < data.meshes.size(); i++)
+			{
+				MeshData& mesh = data.meshes[i];
+				data.packedArrays[i].resize(mesh.numVertices);
+				QuantizeVertices(mesh.vertices, mesh.numVertices, data.packedArrays[i].data(), mesh.boundsMin, mesh.boundsExtent);
+				mesh.packedVertices = data.packedArrays[i].data();
+			}
 		}
 
+		return true;
 	}
 
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	// copies the vertex attributes and face indices of an ASSIMP mesh, in ASSIMP's order
+	static void ReadGeometry(const aiMesh *mesh, vector<Vertex> &vertices, vector<unsigned int> &indices)
 	{
-		// data to fill
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
-
 		// Walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
@@ -101,10 +384,15 @@ private:
 			vector.z = mesh->mVertices[i].z;
 			vertex.Position = vector;
 			// normals
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.Normal = vector;
+			if (mesh->mNormals)
+			{
+				vector.x = mesh->mNormals[i].x;
+				vector.y = mesh->mNormals[i].y;
+				vector.z = mesh->mNormals[i].z;
+				vertex.Normal = vector;
+			}
+			else
+				vertex.Normal = glm::vec3(0.0f, 0.0f, 0.0f);
 			// texture coordinates
 			if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
 			{
@@ -117,26 +405,190 @@ private:
 			}
 			else
 				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-			// tangent
-			vector.x = mesh->mTangents[i].x;
-			vector.y = mesh->mTangents[i].y;
-			vector.z = mesh->mTangents[i].z;
-			vertex.Tangent = vector;
-			// bitangent
-			vector.x = mesh->mBitangents[i].x;
-			vector.y = mesh->mBitangents[i].y;
-			vector.z = mesh->mBitangents[i].z;
-			vertex.Bitangent = vector;
+			// tangent and bitangent, missing when the mesh has no texture coordinates to derive them from
+			if (mesh->mTangents && mesh->mBitangents)
+			{
+				vector.x = mesh->mTangents[i].x;
+				vector.y = mesh->mTangents[i].y;
+				vector.z = mesh->mTangents[i].z;
+				vertex.Tangent = vector;
+				vector.x = mesh->mBitangents[i].x;
+				vector.y = mesh->mBitangents[i].y;
+				vector.z = mesh->mBitangents[i].z;
+				vertex.Bitangent = vector;
+			}
+			else
+			{
+				vertex.Tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+				vertex.Bitangent = glm::vec3(0.0f, 0.0f, 0.0f);
+			}
 			vertices.push_back(vertex);
 		}
 		// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
 		{
-			aiFace face = mesh->mFaces[i];
+			const aiFace& face = mesh->mFaces[i];
 			// retrieve all indices of the face and store them in the indices vector
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
 				indices.push_back(face.mIndices[j]);
 		}
+	}
+
+	// creates the GL buffers for one mesh of the loaded data, GL thread only. Returns the number of bytes uploaded.
+	// Under CPUDataPolicy::Keep the mesh's arrays are moved out of the data (or decoded from the cache) into the Mesh.
+	size_t UploadMesh(ModelData &data, size_t index)
+	{
+		ProfileScope scope("upload", data.directory);
+		const MeshData& mesh = data.meshes[index];
+		directory = data.directory;
+		if (!arena)
+			createArena(data);
+
+		size_t vertexBytes;
+		if (mesh.packedVertices)
+		{
+			meshes.emplace_back(arena, mesh.packedVertices, mesh.numVertices, mesh.boundsMin, mesh.boundsExtent, mesh.indices, mesh.indexType, mesh.numIndices, mesh.textures);
+			vertexBytes = mesh.numVertices * sizeof(PackedVertex);
+		}
+		else
+		{
+			meshes.emplace_back(arena, mesh.vertices, mesh.numVertices, mesh.indices, mesh.indexType, mesh.numIndices, mesh.textures);
+			vertexBytes = mesh.numVertices * sizeof(Vertex);
+		}
+		meshes.back().meshlets = mesh.meshlets;
+		meshes.back().uvDensity = mesh.uvDensity;
+		size_t indexBytes = mesh.numIndices * GetIndexSize(mesh.indexType);
+		for (const MeshLod& lod : mesh.lods)
+		{
+			meshes.back().AddLod(lod.indices, lod.numIndices, lod.error);
+			indexBytes += lod.numIndices * GetIndexSize(mesh.indexType);
+		}
+
+		// grow the bounding sphere around the mesh bounds
+		glm::vec3 boundsMax = mesh.boundsMin + mesh.boundsExtent;
+		if (meshes.size() == 1)
+		{
+			modelMin = mesh.boundsMin;
+			modelMax = boundsMax;
+		}
+		else
+		{
+			modelMin = glm::min(modelMin, mesh.boundsMin);
+			modelMax = glm::max(modelMax, boundsMax);
+		}
+		boundingCenter = (modelMin + modelMax) * 0.5f;
+		boundingRadius = glm::length(modelMax - modelMin) * 0.5f;
+
+		if (cpuDataPolicy == CPUDataPolicy::Keep)
+			keepCPUData(data, index, meshes.back());
+		if (meshes.size() == data.meshes.size())
+			meshesUploaded = true;
+
+		return vertexBytes + indexBytes;
+	}
+
+private:
+	bool meshesUploaded = false;
+	bool resident = false;
+	shared_ptr<GeometryArena> arena;
+	bool sharedArena = false;
+	glm::vec3 modelMin = glm::vec3(0.0f), modelMax = glm::vec3(0.0f);
+	glm::vec3 boundingCenter = glm::vec3(0.0f);
+	float boundingRadius = 0.0f;
+
+	// picks the arena for the model's meshes and makes room for all of them at once
+	void createArena(const ModelData &data)
+	{
+		VertexFormat format = !data.meshes.empty() && data.meshes[0].packedVertices ? VertexFormat::Packed : VertexFormat::Float;
+		sharedArena = useSharedArena;
+		arena = sharedArena ? GeometryArena::GetShared(format) : make_shared<GeometryArena>(format);
+
+		size_t vertices = 0, indexBytes = 0;
+		for (const MeshData& mesh : data.meshes)
+		{
+			vertices += mesh.numVertices;
+			indexBytes += GeometryArena::AlignIndexBytes(mesh.numIndices * GetIndexSize(mesh.indexType));
+			for (const MeshLod& lod : mesh.lods)
+				indexBytes += GeometryArena::AlignIndexBytes(lod.numIndices * GetIndexSize(mesh.indexType));
+		}
+		arena->Reserve(arena->GetVertexCount() + vertices, arena->GetIndexBytes() + indexBytes);
+	}
+
+	// gives the uploaded mesh a float copy of its vertices and 32 bit indices
+	static void keepCPUData(ModelData &data, size_t index, Mesh &target)
+	{
+		const MeshData& mesh = data.meshes[index];
+
+		// freshly imported arrays are already in that form and aren't needed by anything else once uploaded
+		if (index < data.vertexArrays.size() && data.vertexArrays[index].size() == mesh.numVertices)
+		{
+			target.vertices = std::move(data.vertexArrays[index]);
+			target.indices = std::move(data.indexArrays[index]);
+			return;
+		}
+
+		if (mesh.packedVertices)
+		{
+			target.vertices.resize(mesh.numVertices);
+			for (unsigned int i = 0; i < mesh.numVertices; i++)
+				target.vertices[i] = DequantizeVertex(mesh.packedVertices[i], mesh.boundsMin, mesh.boundsExtent);
+		}
+		else
+			target.vertices.assign(mesh.vertices, mesh.vertices + mesh.numVertices);
+
+		if (mesh.indexType == GL_UNSIGNED_SHORT)
+		{
+			const uint16_t* indices = static_cast<const uint16_t*>(mesh.indices);
+			target.indices.assign(indices, indices + mesh.numIndices);
+		}
+		else
+		{
+			const unsigned int* indices = static_cast<const unsigned int*>(mesh.indices);
+			target.indices.assign(indices, indices + mesh.numIndices);
+		}
+	}
+
+	/*  Functions   */
+	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+	static void processNode(aiNode *node, const aiScene *scene, ModelData &data)
+	{
+		// process each mesh located at the current node
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			// the node object only contains indices to index the actual objects in the scene. 
+			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			processMesh(mesh, scene, data);
+		}
+		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+		for (unsigned int i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(node->mChildren[i], scene, data);
+		}
+
+	}
+
+	static void processMesh(aiMesh *mesh, const aiScene *scene, ModelData &data)
+	{
+		// data to fill
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		vector<Texture> textures;
+
+		ReadGeometry(mesh, vertices, indices);
+		// merge duplicated corners, then reorder for the post-transform cache, overdraw and vertex fetch, group the
+		// triangles into meshlets and build the LOD chain on the result. All of it goes into the baked cache.
+		vector<LodLevel> lods;
+		vector<Meshlet> meshlets;
+		if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+		{
+			WeldVertices(vertices, indices, weldEpsilon);
+			OptimizeMesh(vertices, indices);
+			if (buildMeshlets)
+				meshlets = BuildOptimizedMeshlets(vertices, indices);
+			if (generateLods)
+				lods = GenerateLodChain(vertices, indices);
+		}
 		// process materials
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -147,54 +599,99 @@ private:
 		// normal: texture_normalN
 
 		// 1. diffuse maps
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data);
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 		// 2. specular maps
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data);
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 		// 3. normal maps
-		std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+		std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 		// 4. height maps
-		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data);
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		// store the extracted mesh data, the array pointers are filled in once all meshes are processed
+		MeshData result;
+		result.numVertices = (unsigned int)vertices.size();
+		result.numIndices = (unsigned int)indices.size();
+		result.textures = textures;
+		result.meshlets = std::move(meshlets);
+		result.uvDensity = computeUvDensity(vertices, indices);
+		if (!vertices.empty())
+		{
+			glm::vec3 boundsMax = vertices[0].Position;
+			result.boundsMin = vertices[0].Position;
+			for (const Vertex& vertex : vertices)
+			{
+				result.boundsMin = glm::min(result.boundsMin, vertex.Position);
+				boundsMax = glm::max(boundsMax, vertex.Position);
+			}
+			result.boundsExtent = boundsMax - result.boundsMin;
+		}
+		vector<vector<unsigned int>> lodIndices;
+		for (LodLevel& lod : lods)
+		{
+			MeshLod ref;
+			ref.numIndices = (unsigned int)lod.indices.size();
+			ref.error = lod.error;
+			result.lods.push_back(ref);
+			lodIndices.push_back(std::move(lod.indices));
+		}
+		data.vertexArrays.push_back(std::move(vertices));
+		data.indexArrays.push_back(std::move(indices));
+		data.lodArrays.push_back(std::move(lodIndices));
+		data.meshes.push_back(result);
+	}
+
+	// average object space size of one UV unit over the surface, from the total triangle areas in both spaces
+	static float computeUvDensity(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+	{
+		double area = 0.0, uvArea = 0.0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const Vertex& a = vertices[indices[i]];
+			const Vertex& b = vertices[indices[i + 1]];
+			const Vertex& c = vertices[indices[i + 2]];
+			area += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position)) * 0.5;
+			glm::vec2 u = b.TexCoords - a.TexCoords, v = c.TexCoords - a.TexCoords;
+			uvArea += std::abs(u.x * v.y - u.y * v.x) * 0.5;
+		}
+		return uvArea > 0.0 ? (float)std::sqrt(area / uvArea) : 0.0f;
 	}
 
 	// checks all material textures of a given type and loads the textures if they're not loaded yet.
 	// the required info is returned as a Texture struct.
-	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+	static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, ModelData const &data)
 	{
 		vector<Texture> textures;
 		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
+			if (data.acquireTextures)
+				textures.push_back(loadTexture(str.C_Str(), typeName, data.directory));
+			else
 			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
 				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
 				texture.type = typeName;
 				texture.path = str.C_Str();
 				textures.push_back(texture);
-				textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
 			}
 		}
 		return textures;
 	}
 
-	unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+	// points the meshes at the arrays of the mapped cache and requests their textures
+	static void useCachedMeshes(ModelData &data)
+	{
+		data.meshes = data.cache.GetMeshes();
+		for (MeshData& mesh : data.meshes)
+			for (Texture& texture : mesh.textures)
+				texture = loadTexture(texture.path.c_str(), texture.type, data.directory);
+	}
+
+	// returns the texture at the given path (relative to the model directory) from the process wide texture cache,
+	// so every model using the same image shares one decode and one GL texture.
+	static Texture loadTexture(const char *path, string const &typeName, string const &directory);
 };
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "PakArchive.h"
+#include "FileSystem.h"
+#include "LZCompression.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// On-disk layout: header | table of contents, sorted by name | names | (64 byte aligned) entry data
+struct PakHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t tocOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+struct PakArchive::TocRecord {
+	uint64_t offset;
+	uint64_t storedSize;	// bytes in the archive
+	uint64_t size;			// bytes once decompressed
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t compression;
+	uint32_t reserved;
+};
+
+enum PakCompression : uint32_t {
+	PAK_STORED = 0,
+	PAK_LZ = 1
+};
+
+static const char PAK_MAGIC[4] = { 'P', 'A', 'K', '1' };
+static const size_t ENTRY_ALIGNMENT = 64;
+
+const char* const PakArchive::DEFAULT_PATH = "./assets.pak";
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+PakArchive& PakArchive::Get()
+{
+	static PakArchive archive;
+	return archive;
+}
+
+bool PakArchive::Mount(const std::string& path)
+{
+	Unmount();
+
+	if (!m_file.Open(path))
+		return false;
+
+	const unsigned char* data = m_file.Data();
+	size_t size = m_file.Size();
+	PakHeader header;
+	if (size < sizeof(header))
+	{
+		Unmount();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	uint64_t tocSize = (uint64_t)header.entryCount * sizeof(TocRecord);
+	if (memcmp(header.magic, PAK_MAGIC, 4) != 0 || header.version != VERSION ||
+		header.tocOffset > size || tocSize > size - header.tocOffset ||
+		header.stringsOffset > size || header.stringsSize > size - header.stringsOffset)
+	{
+		std::cout << "ERROR::PAK_ARCHIVE::INVALID " << path << std::endl;
+		Unmount();
+		return false;
+	}
+
+	const TocRecord* toc = reinterpret_cast<const TocRecord*>(data + header.tocOffset);
+	for (uint32_t i = 0; i < header.entryCount; i++)
+	{
+		if (toc[i].offset > size || toc[i].storedSize > size - toc[i].offset ||
+			(uint64_t)toc[i].nameOffset + toc[i].nameLength > header.stringsSize ||
+			toc[i].compression > PAK_LZ || (toc[i].compression == PAK_STORED && toc[i].storedSize != toc[i].size))
+		{
+			std::cout << "ERROR::PAK_ARCHIVE::INVALID " << path << std::endl;
+			Unmount();
+			return false;
+		}
+	}
+
+	m_toc = toc;
+	m_count = header.entryCount;
+	m_strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+	// one large read now instead of a page fault per first touch during loading
+	m_file.Prefetch();
+	return true;
+}
+
+void PakArchive::Unmount()
+{
+	m_toc = nullptr;
+	m_count = 0;
+	m_strings = nullptr;
+	m_file.Close();
+}
+
+const PakArchive::TocRecord* PakArchive::find(const std::string& path) const
+{
+	if (!m_toc)
+		return nullptr;
+
+	std::string key = CanonicalPath(path);
+	auto compare = [this](const TocRecord& record, const std::string& name)
+	{
+		return std::string(m_strings + record.nameOffset, record.nameLength) < name;
+	};
+	const TocRecord* record = std::lower_bound(m_toc, m_toc + m_count, key, compare);
+	if (record == m_toc + m_count || record->nameLength != key.size() || memcmp(m_strings + record->nameOffset, key.data(), key.size()) != 0)
+		return nullptr;
+	return record;
+}
+
+bool PakArchive::Contains(const std::string& path) const
+{
+	return find(path) != nullptr;
+}
+
+bool PakArchive::Read(const std::string& path, const unsigned char*& data, size_t& size, std::vector<unsigned char>& storage) const
+{
+	const TocRecord* record = find(path);
+	if (!record)
+		return false;
+
+	const unsigned char* stored = m_file.Data() + record->offset;
+	if (record->compression == PAK_STORED)
+	{
+		data = stored;
+		size = (size_t)record->size;
+		return true;
+	}
+
+	storage.resize((size_t)record->size);
+	if (!DecompressLZ(stored, (size_t)record->storedSize, storage.data(), storage.size()))
+	{
+		std::cout << "ERROR::PAK_ARCHIVE::CORRUPT_ENTRY " << path << std::endl;
+		return false;
+	}
+	data = storage.data();
+	size = storage.size();
+	return true;
+}
+
+bool PakArchive::Write(const std::string& archivePath, const std::vector<Input>& inputs)
+{
+	struct Pending {
+		std::string name;
+		std::vector<unsigned char> bytes;
+		uint64_t size;
+		uint32_t compression;
+	};
+
+	std::vector<Pending> entries;
+	for (const Input& input : inputs)
+	{
+		MappedFile file;
+		int64_t modified;
+		Pending entry;
+		entry.name = CanonicalPath(input.name);
+		entry.compression = PAK_STORED;
+		entry.size = 0;
+		if (file.Open(input.file))
+		{
+			entry.size = file.Size();
+			// only worth it if the entry shrinks by at least an eighth, decompressing costs time at load
+			std::vector<unsigned char> compressed;
+			if (input.compress)
+				compressed = CompressLZ(file.Data(), file.Size());
+			if (input.compress && compressed.size() < file.Size() - file.Size() / 8)
+			{
+				entry.bytes = std::move(compressed);
+				entry.compression = PAK_LZ;
+			}
+			else
+				entry.bytes.assign(file.Data(), file.Data() + file.Size());
+		}
+		// MappedFile refuses empty files, an existing one is stored as an empty entry
+		else if (!GetModificationTime(input.file, modified))
+		{
+			std::cout << "ERROR::PAK_ARCHIVE::COULD_NOT_READ " << input.file << std::endl;
+			return false;
+		}
+		entries.push_back(std::move(entry));
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Pending& a, const Pending& b) { return a.name < b.name; });
+	for (size_t i = 1; i < entries.size(); i++)
+	{
+		if (entries[i].name == entries[i - 1].name)
+		{
+			std::cout << "ERROR::PAK_ARCHIVE::DUPLICATE_ENTRY " << entries[i].name << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<TocRecord> toc(entries.size());
+	std::string strings;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		toc[i].nameOffset = (uint32_t)strings.size();
+		toc[i].nameLength = (uint32_t)entries[i].name.size();
+		toc[i].storedSize = entries[i].bytes.size();
+		toc[i].size = entries[i].size;
+		toc[i].compression = entries[i].compression;
+		toc[i].reserved = 0;
+		strings += entries[i].name;
+	}
+
+	PakHeader header;
+	memcpy(header.magic, PAK_MAGIC, 4);
+	header.version = VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.reserved = 0;
+	header.tocOffset = sizeof(PakHeader);
+	header.stringsOffset = header.tocOffset + toc.size() * sizeof(TocRecord);
+	header.stringsSize = strings.size();
+
+	size_t offset = (size_t)(header.stringsOffset + header.stringsSize);
+	for (TocRecord& record : toc)
+	{
+		offset = AlignUp(offset, ENTRY_ALIGNMENT);
+		record.offset = offset;
+		offset += (size_t)record.storedSize;
+	}
+
+	// write to a temporary file first so a crash never leaves a half written archive behind
+	std::string tempPath = archivePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!toc.empty())
+			out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(TocRecord));
+		out.write(strings.data(), strings.size());
+		size_t position = (size_t)(header.stringsOffset + header.stringsSize);
+		static const char padding[ENTRY_ALIGNMENT] = {};
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			out.write(padding, (size_t)toc[i].offset - position);
+			if (!entries[i].bytes.empty())
+				out.write(reinterpret_cast<const char*>(entries[i].bytes.data()), entries[i].bytes.size());
+			position = (size_t)(toc[i].offset + toc[i].storedSize);
+		}
+		if (!out)
+		{
+			std::cout << "ERROR::PAK_ARCHIVE::COULD_NOT_WRITE " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(archivePath.c_str());
+	if (std::rename(tempPath.c_str(), archivePath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		std::cout << "ERROR::PAK_ARCHIVE::COULD_NOT_WRITE " << archivePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool AssetFile::Open(const std::string& path)
+{
+	Close();
+
+	if (PakArchive::Get().Read(path, m_data, m_size, m_storage))
+	{
+		// empty entries still count as open
+		static const unsigned char empty = 0;
+		if (!m_data)
+			m_data = &empty;
+		return true;
+	}
+
+	if (!m_file.Open(path))
+		return false;
+	m_data = m_file.Data();
+	m_size = m_file.Size();
+	return true;
+}
+
+void AssetFile::Close()
+{
+	m_data = nullptr;
+	m_size = 0;
+	std::vector<unsigned char>().swap(m_storage);
+	m_file.Close();
+}
+
+bool AssetFile::Exists(const std::string& path)
+{
+	int64_t time;
+	return PakArchive::Get().Contains(path) || GetModificationTime(path, time);
+}
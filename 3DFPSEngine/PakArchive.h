@@ -0,0 +1,81 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Single file archive of assets. The whole archive is mapped once when mounted, so loading an asset from it is a
+// binary search of the table of contents plus a pointer into the mapping, instead of an open/stat/read/close per file.
+// Entries start 64 byte aligned so the baked formats that are used in place (mesh caches, texture containers) keep
+// their internal alignment. Entries can be LZ compressed, those are decompressed into memory when opened.
+// Paths are canonical (see CanonicalPath) and relative to the working directory, like "shaders/shader.vert".
+class PakArchive
+{
+public:
+	static const uint32_t VERSION = 1;
+	static const char* const DEFAULT_PATH;
+
+	// the archive the engine loads from, if one is mounted
+	static PakArchive& Get();
+
+	PakArchive() {}
+	PakArchive(const PakArchive&) = delete;
+	PakArchive& operator=(const PakArchive&) = delete;
+
+	// maps and validates the archive and prefetches it in one sequential read. Mount before any loading starts,
+	// after that the archive may be read from any thread.
+	bool Mount(const std::string& path);
+	void Unmount();
+	bool IsMounted() const { return m_file.IsOpen(); }
+
+	bool Contains(const std::string& path) const;
+	// the bytes of an entry: compressed entries are decompressed into storage, others point into the mapping
+	bool Read(const std::string& path, const unsigned char*& data, size_t& size, std::vector<unsigned char>& storage) const;
+
+	size_t GetEntryCount() const { return m_count; }
+
+	struct Input {
+		std::string name;	// path inside the archive, canonicalised when written
+		std::string file;	// file to read it from
+		bool compress;		// LZ compress it if that saves space
+	};
+	// writes an archive from loose files, replacing it atomically
+	static bool Write(const std::string& archivePath, const std::vector<Input>& inputs);
+
+private:
+	struct TocRecord;
+	const TocRecord* find(const std::string& path) const;
+
+	MappedFile m_file;
+	const TocRecord* m_toc = nullptr;
+	uint32_t m_count = 0;
+	const char* m_strings = nullptr;
+};
+
+// Read-only view of one asset's bytes: from the mounted PakArchive when it holds the path, otherwise the loose file
+// is mapped. Use this instead of opening asset files directly.
+class AssetFile
+{
+public:
+	AssetFile() {}
+	AssetFile(const AssetFile&) = delete;
+	AssetFile& operator=(const AssetFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const unsigned char* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+	// whether the asset exists, without reading it
+	static bool Exists(const std::string& path);
+
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+	std::vector<unsigned char> m_storage;	// decompressed archive entry
+	MappedFile m_file;						// loose file
+};
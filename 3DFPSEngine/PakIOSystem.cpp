@@ -0,0 +1,66 @@
+#include "PakIOSystem.h"
+#include "PakArchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+// stream over an AssetFile, either straight out of the archive mapping or a mapped loose file
+class PakIOStream : public Assimp::IOStream
+{
+public:
+	bool Open(const char* path) { return m_file.Open(path); }
+
+	size_t Read(void* pvBuffer, size_t pSize, size_t pCount) override
+	{
+		if (pSize == 0)
+			return 0;
+		size_t count = std::min(pCount, (m_file.Size() - m_position) / pSize);
+		memcpy(pvBuffer, m_file.Data() + m_position, count * pSize);
+		m_position += count * pSize;
+		return count;
+	}
+
+	size_t Write(const void*, size_t, size_t) override { return 0; }
+
+	aiReturn Seek(size_t pOffset, aiOrigin pOrigin) override
+	{
+		size_t base = pOrigin == aiOrigin_SET ? 0 : pOrigin == aiOrigin_CUR ? m_position : m_file.Size();
+		if (pOrigin == aiOrigin_END ? pOffset > base : pOffset > m_file.Size() - base)
+			return aiReturn_FAILURE;
+		m_position = pOrigin == aiOrigin_END ? base - pOffset : base + pOffset;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const override { return m_position; }
+	size_t FileSize() const override { return m_file.Size(); }
+	void Flush() override {}
+
+private:
+	AssetFile m_file;
+	size_t m_position = 0;
+};
+
+bool PakIOSystem::Exists(const char* pFile) const
+{
+	return AssetFile::Exists(pFile);
+}
+
+Assimp::IOStream* PakIOSystem::Open(const char* pFile, const char* pMode)
+{
+	// assets are never written at runtime
+	if (strchr(pMode, 'w') || strchr(pMode, 'a') || strchr(pMode, '+'))
+		return nullptr;
+
+	PakIOStream* stream = new PakIOStream();
+	if (!stream->Open(pFile))
+	{
+		delete stream;
+		return nullptr;
+	}
+	return stream;
+}
+
+void PakIOSystem::Close(Assimp::IOStream* pFile)
+{
+	delete pFile;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+// Lets Assimp read models and the files they reference (.mtl, ...) through AssetFile, so imports are served
+// from the mounted PakArchive when there is one. Read-only. Usage: importer.SetIOHandler(new PakIOSystem());
+// the importer takes ownership.
+class PakIOSystem : public Assimp::IOSystem
+{
+public:
+	bool Exists(const char* pFile) const override;
+	char getOsSeparator() const override { return '/'; }
+	Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override;
+	void Close(Assimp::IOStream* pFile) override;
+};
@@ -0,0 +1,148 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <utility>
+
+bool Profiler::enabled = false;
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+uint32_t Profiler::threadIndex()
+{
+	static std::atomic<uint32_t> next{ 0 };
+	thread_local uint32_t index = next++;
+	return index;
+}
+
+void Profiler::Record(const char* category, const std::string& name, Clock::time_point start, Clock::time_point end)
+{
+	Event event;
+	event.category = category;
+	event.name = name;
+	event.start = std::chrono::duration_cast<std::chrono::microseconds>(start - m_origin).count();
+	event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	event.thread = threadIndex();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (IsRecording())
+		m_events.push_back(std::move(event));
+}
+
+// JSON string contents, paths may hold backslashes and quotes
+static std::string Escape(const std::string& text)
+{
+	std::string escaped;
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+			escaped += code;
+		}
+		else
+			escaped += c;
+	}
+	return escaped;
+}
+
+bool Profiler::Finish(const std::string& tracePath, const std::string& summaryPath)
+{
+	if (!IsRecording())
+		return false;
+
+	Record("startup", "startup", m_origin, Clock::now());
+	uint32_t mainThread = threadIndex();
+
+	std::vector<Event> events;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finished = true;
+		events.swap(m_events);
+	}
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+
+	// ----- TRACE -----
+
+	std::ofstream trace(tracePath, std::ios::trunc);
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	uint32_t threads = 0;
+	for (const Event& event : events)
+		threads = std::max(threads, event.thread + 1);
+	for (uint32_t t = 0; t < threads; t++)
+	{
+		trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":\""
+			<< (t == mainThread ? std::string("main") : "worker " + std::to_string(t)) << "\"}},\n";
+	}
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const Event& event = events[i];
+		trace << "{\"name\":\"" << Escape(event.name) << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":" << event.start
+			<< ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << event.thread << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+	}
+	trace << "]}\n";
+	if (!trace)
+	{
+		std::cout << "ERROR::PROFILER::COULD_NOT_WRITE " << tracePath << std::endl;
+		return false;
+	}
+
+	// ----- SUMMARY -----
+
+	struct Total {
+		int64_t total = 0;
+		int64_t longest = 0;
+		size_t count = 0;
+	};
+	std::map<std::pair<std::string, std::string>, Total> byName;
+	std::map<std::string, Total> byCategory;
+	for (const Event& event : events)
+	{
+		for (Total* total : { &byName[std::make_pair(std::string(event.category), event.name)], &byCategory[event.category] })
+		{
+			total->total += event.duration;
+			total->longest = std::max(total->longest, event.duration);
+			total->count++;
+		}
+	}
+
+	typedef std::pair<std::pair<std::string, std::string>, Total> NamedTotal;
+	std::vector<NamedTotal> sorted(byName.begin(), byName.end());
+	std::sort(sorted.begin(), sorted.end(), [](const NamedTotal& a, const NamedTotal& b) { return a.second.total > b.second.total; });
+	typedef std::pair<std::string, Total> CategoryTotal;
+	std::vector<CategoryTotal> categories(byCategory.begin(), byCategory.end());
+	std::sort(categories.begin(), categories.end(), [](const CategoryTotal& a, const CategoryTotal& b) { return a.second.total > b.second.total; });
+
+	FILE* summary = fopen(summaryPath.c_str(), "w");
+	if (!summary)
+	{
+		std::cout << "ERROR::PROFILER::COULD_NOT_WRITE " << summaryPath << std::endl;
+		return false;
+	}
+	// worker time overlaps the main thread, so categories can add up to more than the startup time
+	fprintf(summary, "%zu events on %u threads, trace in %s\n\n", events.size(), threads, tracePath.c_str());
+	fprintf(summary, "%12s %12s %8s  %s\n", "total ms", "longest ms", "count", "category");
+	for (const CategoryTotal& category : categories)
+		fprintf(summary, "%12.2f %12.2f %8zu  %s\n", category.second.total / 1000.0, category.second.longest / 1000.0, category.second.count, category.first.c_str());
+	fprintf(summary, "\n%12s %12s %8s  %-12s %s\n", "total ms", "longest ms", "count", "category", "name");
+	for (const NamedTotal& entry : sorted)
+	{
+		fprintf(summary, "%12.2f %12.2f %8zu  %-12s %s\n", entry.second.total / 1000.0, entry.second.longest / 1000.0, entry.second.count,
+			entry.first.first.c_str(), entry.first.second.c_str());
+	}
+	fclose(summary);
+	return true;
+}
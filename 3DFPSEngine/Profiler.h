@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records how long startup phases and individual asset loads take, on whichever thread they run. At the end of
+// startup Finish writes the events as a Chrome trace (load it in chrome://tracing or ui.perfetto.dev) plus a text
+// summary sorted by total time. Recording stops after Finish, scopes are then close to free.
+class Profiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// set before startup to record, main turns it on with --profile-startup
+	static bool enabled;
+
+	static Profiler& Get();
+
+	bool IsRecording() const { return enabled && !m_finished; }
+
+	// adds one timed event, safe to call from any thread. ProfileScope covers most uses, this is for phases that
+	// don't match a block, such as constructing an object that has to outlive it.
+	void Record(const char* category, const std::string& name, Clock::time_point start, Clock::time_point end);
+
+	// writes the trace and the summary and stops recording. Call on the main thread.
+	bool Finish(const std::string& tracePath, const std::string& summaryPath);
+
+private:
+	Profiler() : m_origin(Clock::now()) {}
+
+	struct Event {
+		const char* category;
+		std::string name;
+		int64_t start;		// microseconds since the profiler was created
+		int64_t duration;
+		uint32_t thread;
+	};
+
+	// small stable number for the calling thread, in order of first use
+	static uint32_t threadIndex();
+
+	Clock::time_point m_origin;
+	std::atomic<bool> m_finished{ false };
+	std::mutex m_mutex;
+	std::vector<Event> m_events;
+};
+
+// Times the enclosing block: ProfileScope scope("decode", path);
+// category groups events in the summary, name identifies the phase or asset.
+class ProfileScope
+{
+public:
+	ProfileScope(const char* category, const std::string& name)
+		: m_category(category)
+	{
+		if (Profiler::Get().IsRecording())
+		{
+			m_name = name;
+			m_start = Profiler::Clock::now();
+			m_active = true;
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (m_active)
+			Profiler::Get().Record(m_category, m_name, m_start, Profiler::Clock::now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_category;
+	std::string m_name;
+	Profiler::Clock::time_point m_start;
+	bool m_active = false;
+};
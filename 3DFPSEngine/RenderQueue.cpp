@@ -0,0 +1,326 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "Hash.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+bool RenderQueue::enabled = true;
+bool RenderQueue::instancing = true;
+unsigned int RenderQueue::reportInterval = 0;
+
+RenderQueue& RenderQueue::Get()
+{
+	static RenderQueue queue;
+	return queue;
+}
+
+// the top 24 bits of a non-negative float, which sort like the float
+static uint64_t QuantizeDepth(float depth)
+{
+	if (!(depth > 0.0f))
+		return 0;
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> 7;
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t shader, uint32_t geometry, uint32_t material, float depth)
+{
+	uint64_t state = (uint64_t)(shader & 0xFF) << 28 | (uint64_t)(geometry & 0xFFF) << 16 | (material & 0xFFFF);
+	uint64_t depthBits = QuantizeDepth(depth);
+	if (pass == RenderPass::Opaque)
+		return (uint64_t)pass << 62 | state << 26 | depthBits << 2;
+	return (uint64_t)pass << 62 | (~depthBits & 0xFFFFFF) << 38 | state << 2;
+}
+
+void RenderQueue::RadixSort(vector<SortEntry>& entries, vector<SortEntry>& scratch)
+{
+	// all eight histograms in one pass over the keys
+	size_t counts[8][256] = {};
+	for (const SortEntry& entry : entries)
+		for (int b = 0; b < 8; b++)
+			counts[b][(entry.key >> (b * 8)) & 0xFF]++;
+
+	scratch.resize(entries.size());
+	for (int b = 0; b < 8; b++)
+	{
+		// a byte every key shares doesn't change the order
+		size_t* histogram = counts[b];
+		if (histogram[(entries.empty() ? 0 : entries[0].key >> (b * 8)) & 0xFF] == entries.size())
+			continue;
+
+		size_t offsets[256];
+		size_t offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			offsets[i] = offset;
+			offset += histogram[i];
+		}
+		for (const SortEntry& entry : entries)
+			scratch[offsets[(entry.key >> (b * 8)) & 0xFF]++] = entry;
+		entries.swap(scratch);
+	}
+}
+
+uint32_t RenderQueue::getId(unordered_map<uint64_t, uint32_t>& ids, uint64_t value)
+{
+	auto found = ids.find(value);
+	if (found != ids.end())
+		return found->second;
+	uint32_t id = (uint32_t)ids.size();
+	ids[value] = id;
+	return id;
+}
+
+void RenderQueue::trimIds(unordered_map<uint64_t, uint32_t>& ids, uint32_t limit)
+{
+	// values that are gone, like the names of evicted textures, would otherwise pile up. Starting over only costs
+	// the grouping of the next frame.
+	if (ids.size() > limit)
+		ids.clear();
+}
+
+uint32_t RenderQueue::AddObject(const glm::mat4& model, const MeshletCullView* cull)
+{
+	Object object;
+	object.model = model;
+	object.culled = cull != nullptr;
+	if (cull)
+		object.cull = *cull;
+	m_objects.push_back(object);
+	return (uint32_t)m_objects.size() - 1;
+}
+
+void RenderQueue::Add(RenderPass pass, Shader& shader, Shader::Uniform modelUniform, Mesh& mesh, unsigned int lod, uint32_t object, float depth)
+{
+	// meshes with the same textures in the same order bind the same way
+	uint64_t textures = HASH_SEED;
+	for (const Texture& texture : mesh.textures)
+	{
+		unsigned int id = texture.handle ? texture.handle->GetID() : 0;
+		textures = HashBytes(&id, sizeof(id), textures);
+	}
+
+	Packet packet;
+	packet.shader = &shader;
+	packet.mesh = &mesh;
+	packet.object = object;
+	packet.material = getId(m_materialIds, textures);
+	packet.modelUniform = modelUniform;
+	packet.lod = std::min(lod, mesh.GetLodCount() - 1);	// levels past the coarsest batch with it
+	packet.pass = pass;
+
+	SortEntry entry;
+	entry.key = MakeKey(pass, getId(m_shaderIds, (uint64_t)(uintptr_t)&shader), getId(m_geometryIds, mesh.arena->GetVAO()),
+		packet.material, depth);
+	entry.packet = (uint32_t)m_packets.size();
+	m_packets.push_back(packet);
+	m_entries.push_back(entry);
+}
+
+static void SetPassState(RenderPass pass)
+{
+	if (pass == RenderPass::Transparent)
+	{
+		GLState::Get().Enable(GL_BLEND);
+		GLState::Get().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::Get().DepthMask(GL_FALSE);
+	}
+	else
+	{
+		GLState::Get().Disable(GL_BLEND);
+		GLState::Get().DepthMask(GL_TRUE);
+	}
+}
+
+bool RenderQueue::isSameDraw(const Packet& a, const Packet& b)
+{
+	return a.pass == b.pass && a.shader == b.shader && a.mesh == b.mesh && a.lod == b.lod && a.material == b.material;
+}
+
+void RenderQueue::gatherBatches()
+{
+	m_batches.clear();
+	m_entryBatches.resize(m_entries.size());
+	m_runBatches.clear();
+
+	uint64_t run = ~0ull;
+	Shader* shader = nullptr;
+	bool instanced = false;	// whether the shader reads the instance matrix
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		const Packet& packet = m_packets[m_entries[i].packet];
+		if (packet.shader != shader)
+		{
+			shader = packet.shader;
+			if (instancing)
+			{
+				// resolved once per shader, the handle follows the location across Reload
+				auto found = m_instancedUniforms.find(shader->GetSerial());
+				if (found == m_instancedUniforms.end())
+					found = m_instancedUniforms.emplace(shader->GetSerial(), shader->GetUniform("instanced")).first;
+				instanced = shader->GetLocation(found->second) >= 0;
+			}
+			else
+				instanced = false;
+		}
+
+		uint32_t batch = (uint32_t)m_batches.size();
+		if (instanced && packet.pass == RenderPass::Opaque)
+		{
+			// any batch of the run of packets with the same state bits. A frame with more values than a key field
+			// holds makes different states share bits, so the batch's packet is compared too, its ids are exact.
+			uint64_t state = m_entries[i].key >> 26;
+			if (state != run)
+			{
+				run = state;
+				m_runBatches.clear();
+			}
+			// the mesh and its level, pointers leave the top byte free
+			uint64_t geometry = (uint64_t)(uintptr_t)packet.mesh ^ (uint64_t)packet.lod << 56;
+			auto found = m_runBatches.find(geometry);
+			if (found != m_runBatches.end() && isSameDraw(m_packets[m_batches[found->second].packet], packet))
+				batch = found->second;
+			else
+				m_runBatches[geometry] = batch;
+		}
+		else
+		{
+			// only the batch right before, so the back to front order holds
+			run = ~0ull;
+			if (instanced && !m_batches.empty() && isSameDraw(m_packets[m_batches.back().packet], packet))
+				batch--;
+		}
+
+		if (batch == m_batches.size())
+		{
+			Batch created;
+			created.packet = m_entries[i].packet;
+			created.count = 0;
+			created.instance = 0;
+			m_batches.push_back(created);
+		}
+		m_batches[batch].count++;
+		m_entryBatches[i] = batch;
+	}
+
+	// every batch of more than one packet gets a consecutive range of matrices, in the order the packets sorted
+	uint32_t instances = 0;
+	for (Batch& batch : m_batches)
+	{
+		if (batch.count < 2)
+			continue;
+		batch.instance = instances;
+		instances += batch.count;
+	}
+	m_instances.resize(instances);
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		Batch& batch = m_batches[m_entryBatches[i]];
+		if (batch.count > 1)
+			m_instances[batch.instance++] = m_objects[m_packets[m_entries[i].packet].object].model;
+	}
+	for (Batch& batch : m_batches)
+		if (batch.count > 1)
+			batch.instance -= batch.count;
+}
+
+void RenderQueue::uploadInstances()
+{
+	if (m_instances.empty())
+		return;
+	if (!m_instanceBuffer)
+		glGenBuffers(1, &m_instanceBuffer);
+
+	size_t bytes = m_instances.size() * sizeof(glm::mat4);
+	if (bytes > m_instanceCapacity)
+		m_instanceCapacity = std::max(bytes, m_instanceCapacity * 2);
+	// orphaning hands the driver new storage, draws of the last frame may still be reading the old one
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.data());
+}
+
+void RenderQueue::Submit()
+{
+	m_stats = Stats();
+	m_stats.packets = m_packets.size();
+	if (enabled)
+		RadixSort(m_entries, m_scratch);
+	gatherBatches();
+	uploadInstances();
+
+	RenderPass pass = RenderPass::Opaque;
+	Shader* shader = nullptr;
+	unsigned int vao = 0;
+	uint32_t material = ~0u;
+	uint32_t object = ~0u;
+	for (const Batch& batch : m_batches)
+	{
+		const Packet& packet = m_packets[batch.packet];
+		bool many = batch.count > 1;
+		if (packet.pass != pass)
+		{
+			pass = packet.pass;
+			SetPassState(pass);
+		}
+		// samplers and the model matrix are per program, a new shader needs them again
+		if (packet.shader != shader)
+		{
+			shader = packet.shader;
+			shader->use();
+			material = ~0u;
+			object = ~0u;
+			m_stats.shaderChanges++;
+		}
+		const Object& drawn = m_objects[packet.object];
+		if (!many && packet.object != object)
+		{
+			object = packet.object;
+			shader->setMat4(packet.modelUniform, drawn.model);
+		}
+		if (packet.mesh->arena->GetVAO() != vao)
+		{
+			packet.mesh->arena->Bind();
+			vao = packet.mesh->arena->GetVAO();
+			m_stats.geometryChanges++;
+		}
+		if (packet.material != material)
+		{
+			packet.mesh->BindMaterial(*shader);
+			material = packet.material;
+			m_stats.materialChanges++;
+		}
+		if (many)
+		{
+			packet.mesh->arena->BindInstances(m_instanceBuffer, batch.instance * sizeof(glm::mat4));
+			packet.mesh->DrawInstances(*shader, packet.lod, batch.count);
+			m_stats.instancedDraws++;
+		}
+		else
+			packet.mesh->DrawGeometry(*shader, packet.lod, drawn.culled ? &drawn.cull : nullptr);
+		m_stats.draws++;
+	}
+
+	if (pass != RenderPass::Opaque)
+		SetPassState(RenderPass::Opaque);
+
+	m_packets.clear();
+	m_objects.clear();
+	m_entries.clear();
+	m_batches.clear();
+
+	trimIds(m_shaderIds, 1 << 8);
+	trimIds(m_geometryIds, 1 << 12);
+	trimIds(m_materialIds, 1 << 16);
+
+	m_submits++;
+	if (reportInterval != 0 && m_submits % reportInterval == 0)
+		printf("Render queue, submit %u: %zu packets in %zu draws (%zu instanced), %zu shader, %zu geometry and %zu material changes\n",
+			m_submits, m_stats.packets, m_stats.draws, m_stats.instancedDraws, m_stats.shaderChanges, m_stats.geometryChanges,
+			m_stats.materialChanges);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Meshlets.h"
+#include "Shader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// passes are drawn in this order
+enum class RenderPass {
+	Opaque = 0,			// front to back, depth writes on
+	Transparent = 1		// back to front, blended, depth writes off
+};
+
+// Collects the draws of a frame as small packets and submits them sorted by a 64-bit key, so consecutive draws share
+// as much state as possible. Components queue their meshes while the scene graph renders, Submit draws them all.
+//
+// Key, most significant first:
+//   opaque:      pass (2) | shader (8) | geometry (12) | material (16) | depth (24) | 0 (2)
+//   transparent: pass (2) | ~depth (24) | shader (8) | geometry (12) | material (16) | 0 (2)
+// shader, geometry (the VAO of the mesh's arena) and material (the set of textures) are small ids handed out by the
+// queue on first sight. Ids are only recycled between frames, within one Submit each stands for one value, but a
+// frame with more values than a field holds shares bits in the key and only sorts less tightly. Depth is the top bits of the positive float, which orders like the float itself.
+//
+// Packets of the same mesh and level that share their state are drawn as one instanced draw: their model matrices
+// go into a per frame instance buffer that shader.vert reads instead of the model uniform. Opaque packets are
+// gathered from everywhere in the run of packets sharing their shader, geometry and material, transparent ones
+// only while they follow each other so the back to front order holds.
+class RenderQueue
+{
+public:
+	// off: draws go out in the order they are queued, for comparison
+	static bool enabled;
+	// off: every packet is a draw of its own with the model uniform
+	static bool instancing;
+	// prints the Stats of every Submit that is a multiple of it, 0 for never
+	static unsigned int reportInterval;
+
+	// the state changes and draws of the last Submit
+	struct Stats {
+		size_t packets = 0;
+		size_t shaderChanges = 0;
+		size_t geometryChanges = 0;
+		size_t materialChanges = 0;
+		size_t draws = 0;
+		size_t instancedDraws = 0;	// of the draws, the ones covering more than one packet
+	};
+
+	static RenderQueue& Get();
+
+	// the per object part of the draws that follow: the model matrix and, for meshlet culling, the camera in object
+	// space. Returns the id to queue the object's meshes with.
+	uint32_t AddObject(const glm::mat4& model, const MeshletCullView* cull);
+	// queues one mesh of an object. modelUniform is the shader's handle for the model matrix, depth the view space
+	// distance the pass is ordered by. The mesh must stay alive until Submit. Objects only batch into instanced
+	// draws if they share the Mesh itself, so identical objects should share one Model.
+	void Add(RenderPass pass, Shader& shader, Shader::Uniform modelUniform, Mesh& mesh, unsigned int lod, uint32_t object, float depth);
+
+	// GL thread: sorts the queued packets and draws them, only binding what differs from the previous packet.
+	// Empties the queue.
+	void Submit();
+
+	const Stats& GetStats() const { return m_stats; }
+
+	static uint64_t MakeKey(RenderPass pass, uint32_t shader, uint32_t geometry, uint32_t material, float depth);
+	// sorts by key, stable, 8 bits per pass and passes whose byte is the same for every key are skipped
+	struct SortEntry {
+		uint64_t key;
+		uint32_t packet;
+	};
+	static void RadixSort(vector<SortEntry>& entries, vector<SortEntry>& scratch);
+
+private:
+	RenderQueue() {}
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	struct Packet {
+		Shader* shader;
+		Mesh* mesh;
+		uint32_t object;
+		uint32_t material;	// id of the mesh's textures, packets with the same one share the binds
+		Shader::Uniform modelUniform;
+		unsigned int lod;
+		RenderPass pass;
+	};
+
+	struct Object {
+		glm::mat4 model;
+		MeshletCullView cull;
+		bool culled;
+	};
+
+	// packets drawn together, in draw order. A batch of one is drawn with the model uniform and meshlet culling.
+	struct Batch {
+		uint32_t packet;		// the first one, it sets the state of the draw
+		uint32_t count;
+		uint32_t instance;		// index of the first model matrix in the instance buffer
+	};
+
+	// ids for the key, handed out in the order the values are first seen
+	static uint32_t getId(unordered_map<uint64_t, uint32_t>& ids, uint64_t value);
+	// starts a table over once it holds more ids than its key field, only between frames
+	static void trimIds(unordered_map<uint64_t, uint32_t>& ids, uint32_t limit);
+	// whether two packets can be drawn by one instanced draw
+	static bool isSameDraw(const Packet& a, const Packet& b);
+	// groups the sorted packets into m_batches and their model matrices into m_instances
+	void gatherBatches();
+	void uploadInstances();
+
+	vector<Packet> m_packets;
+	vector<Object> m_objects;
+	vector<SortEntry> m_entries;
+	vector<SortEntry> m_scratch;
+
+	vector<Batch> m_batches;
+	vector<uint32_t> m_entryBatches;	// batch of each sorted entry
+	unordered_map<uint64_t, uint32_t> m_runBatches;	// mesh and level -> batch, within one run of equal state
+	unordered_map<unsigned int, Shader::Uniform> m_instancedUniforms;	// Shader::GetSerial -> its 'instanced' handle
+	vector<glm::mat4> m_instances;
+	unsigned int m_instanceBuffer = 0;
+	size_t m_instanceCapacity = 0;	// bytes, never shrinks so instance attributes left pointing into it stay valid
+
+	unordered_map<uint64_t, uint32_t> m_shaderIds;
+	unordered_map<uint64_t, uint32_t> m_geometryIds;
+	unordered_map<uint64_t, uint32_t> m_materialIds;
+
+	Stats m_stats;
+	unsigned int m_submits = 0;
+};
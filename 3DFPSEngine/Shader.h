@@ -3,167 +3,408 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GLState.h"
+#include "PakArchive.h"
+#include "Profiler.h"
+
+#include <algorithm>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <vector>
+
+// GLSL source code of the stages of a program, the geometry stage is optional
+struct ShaderSource {
+	std::string vertex;
+	std::string fragment;
+	std::string geometry;
+};
 
 class Shader
 {
 public:
+	// a uniform resolved once by GetUniform and kept by the caller. It indexes this shader's own table of resolved
+	// locations, so it stays valid across Reload but must only be used with the shader that returned it.
+	struct Uniform {
+		int slot = -1;
+	};
+
+	// an active uniform of the linked program, arrays have one entry per element
+	struct UniformInfo {
+		std::string name;
+		GLint location;
+		GLenum type;
+	};
+
 	unsigned int ID;
 	// constructor generates the shader on the fly
 	// ------------------------------------------------------------------------
 	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
 	{
-		// 1. retrieve the vertex/fragment source code from filePath
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::string geometryCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		std::ifstream gShaderFile;
-		// ensure ifstream objects can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		try
+		ID = build(vertexPath, fragmentPath, geometryPath);
+		reflect();
+	}
+	// from source code already in memory, such a shader has no files to reload from
+	explicit Shader(const ShaderSource& source)
+	{
+		ID = compile(source.vertex.c_str(), source.fragment.c_str(), source.geometry.empty() ? nullptr : source.geometry.c_str());
+		reflect();
+	}
+
+	// there is one program per Shader, copies would keep using it after a reload deleted it
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+
+	~Shader()
+	{
+		if (ID != 0)
+			GLState::Get().DeleteProgram(ID);
+	}
+
+	// recompiles the program from its source files. On failure the current program is kept and false is
+	// returned, on success the old program is deleted, so uniforms have to be set again. Uniform handles are
+	// resolved against the new program and stay valid.
+	// ------------------------------------------------------------------------
+	bool Reload()
+	{
+		if (vertexPath.empty())
+			return false;
+
+		unsigned int program = build(vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str());
+		if (program == 0)
 		{
-			// open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			// read file's buffer contents into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-			// if geometry shader path is present, also load a geometry shader
-			if (geometryPath != nullptr)
+			std::cout << "ERROR::SHADER::RELOAD_FAILED keeping the previous program of " << vertexPath << std::endl;
+			return false;
+		}
+
+		if (ID != 0)
+			GLState::Get().DeleteProgram(ID);
+		ID = program;
+		reflect();
+		return true;
+	}
+
+	const std::string& GetVertexPath() const { return vertexPath; }
+	const std::string& GetFragmentPath() const { return fragmentPath; }
+	const std::string& GetGeometryPath() const { return geometryPath; }
+
+	// uniform blocks with this name get the binding point in every program linked afterwards, so buffers bound
+	// there with glBindBufferBase are shared by all shaders declaring the block
+	static void SetBlockBinding(const std::string &block, GLuint binding)
+	{
+		for (auto& entry : blockBindings())
+			if (entry.first == block)
 			{
-				gShaderFile.open(geometryPath);
-				std::stringstream gShaderStream;
-				gShaderStream << gShaderFile.rdbuf();
-				gShaderFile.close();
-				geometryCode = gShaderStream.str();
+				entry.second = binding;
+				return;
 			}
-		}
-		catch (std::ifstream::failure e)
-		{
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
-		const char* vShaderCode = vertexCode.c_str();
-		const char * fShaderCode = fragmentCode.c_str();
-		// 2. compile shaders
-		unsigned int vertex, fragment;
-		// vertex shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
-		// fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
-		// if geometry shader is given, compile geometry shader
-		unsigned int geometry;
-		if (geometryPath != nullptr)
+		blockBindings().push_back(std::make_pair(block, binding));
+	}
+
+	// unique for every Shader object, lets code that keeps handles for several shaders tell them apart
+	unsigned int GetSerial() const { return serial; }
+
+	// the active uniforms of the program sorted by name, read once after every link
+	const std::vector<UniformInfo>& GetUniforms() const { return uniforms; }
+
+	// location of an active uniform from the table above, -1 (which GL ignores) if the program has none by that name
+	GLint GetLocation(const std::string &name) const
+	{
+		auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name, [](const UniformInfo& info, const std::string& key) { return info.name < key; });
+		return it != uniforms.end() && it->name == name ? it->location : -1;
+	}
+	GLint GetLocation(Uniform uniform) const { return uniform.slot >= 0 ? slotLocations[uniform.slot] : -1; }
+
+	// returns the handle for a uniform, asking twice for the same name returns the same handle. Resolve the
+	// uniforms set every frame once up front, the name based setters below search the table on each call.
+	Uniform GetUniform(const std::string &name)
+	{
+		Uniform uniform;
+		auto it = std::find(slotNames.begin(), slotNames.end(), name);
+		uniform.slot = (int)(it - slotNames.begin());
+		if (it == slotNames.end())
 		{
-			const char * gShaderCode = geometryCode.c_str();
-			geometry = glCreateShader(GL_GEOMETRY_SHADER);
-			glShaderSource(geometry, 1, &gShaderCode, NULL);
-			glCompileShader(geometry);
-			checkCompileErrors(geometry, "GEOMETRY");
+			slotNames.push_back(name);
+			slotLocations.push_back(GetLocation(name));
 		}
-		// shader Program
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		if (geometryPath != nullptr)
-			glAttachShader(ID, geometry);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
-		// delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
-		if (geometryPath != nullptr)
-			glDeleteShader(geometry);
-
+		return uniform;
 	}
+
 	// activate the shader
 	// ------------------------------------------------------------------------
 	void use()
 	{
-		glUseProgram(ID);
+		GLState::Get().UseProgram(ID);
 	}
 	// utility uniform functions
 	// ------------------------------------------------------------------------
 	void setBool(const std::string &name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(GetLocation(name), (int)value);
 	}
 	// ------------------------------------------------------------------------
 	void setInt(const std::string &name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(GetLocation(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void setFloat(const std::string &name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(GetLocation(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void setVec2(const std::string &name, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform2fv(GetLocation(name), 1, &value[0]);
 	}
 	void setVec2(const std::string &name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2f(GetLocation(name), x, y);
 	}
 	// ------------------------------------------------------------------------
 	void setVec3(const std::string &name, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(GetLocation(name), 1, &value[0]);
 	}
 	void setVec3(const std::string &name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(GetLocation(name), x, y, z);
 	}
 	// ------------------------------------------------------------------------
 	void setVec4(const std::string &name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform4fv(GetLocation(name), 1, &value[0]);
 	}
 	void setVec4(const std::string &name, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(GetLocation(name), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
 	void setMat2(const std::string &name, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(GetLocation(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat3(const std::string &name, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(GetLocation(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat4(const std::string &name, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(GetLocation(name), 1, GL_FALSE, &mat[0][0]);
+	}
+
+	// the same through pre-resolved handles
+	// ------------------------------------------------------------------------
+	void setBool(Uniform uniform, bool value) const
+	{
+		glUniform1i(GetLocation(uniform), (int)value);
+	}
+	// ------------------------------------------------------------------------
+	void setInt(Uniform uniform, int value) const
+	{
+		glUniform1i(GetLocation(uniform), value);
+	}
+	// ------------------------------------------------------------------------
+	void setFloat(Uniform uniform, float value) const
+	{
+		glUniform1f(GetLocation(uniform), value);
+	}
+	// ------------------------------------------------------------------------
+	void setVec2(Uniform uniform, const glm::vec2 &value) const
+	{
+		glUniform2fv(GetLocation(uniform), 1, &value[0]);
+	}
+	void setVec2(Uniform uniform, float x, float y) const
+	{
+		glUniform2f(GetLocation(uniform), x, y);
+	}
+	// ------------------------------------------------------------------------
+	void setVec3(Uniform uniform, const glm::vec3 &value) const
+	{
+		glUniform3fv(GetLocation(uniform), 1, &value[0]);
+	}
+	void setVec3(Uniform uniform, float x, float y, float z) const
+	{
+		glUniform3f(GetLocation(uniform), x, y, z);
+	}
+	// ------------------------------------------------------------------------
+	void setVec4(Uniform uniform, const glm::vec4 &value) const
+	{
+		glUniform4fv(GetLocation(uniform), 1, &value[0]);
+	}
+	void setVec4(Uniform uniform, float x, float y, float z, float w)
+	{
+		glUniform4f(GetLocation(uniform), x, y, z, w);
+	}
+	// ------------------------------------------------------------------------
+	void setMat2(Uniform uniform, const glm::mat2 &mat) const
+	{
+		glUniformMatrix2fv(GetLocation(uniform), 1, GL_FALSE, &mat[0][0]);
+	}
+	// ------------------------------------------------------------------------
+	void setMat3(Uniform uniform, const glm::mat3 &mat) const
+	{
+		glUniformMatrix3fv(GetLocation(uniform), 1, GL_FALSE, &mat[0][0]);
+	}
+	// ------------------------------------------------------------------------
+	void setMat4(Uniform uniform, const glm::mat4 &mat) const
+	{
+		glUniformMatrix4fv(GetLocation(uniform), 1, GL_FALSE, &mat[0][0]);
 	}
 
 private:
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::string geometryPath;
+
+	unsigned int serial = nextSerial();
+	std::vector<UniformInfo> uniforms;
+	std::vector<std::string> slotNames;		// names handed out by GetUniform, a handle is an index into both
+	std::vector<GLint> slotLocations;
+
+	static std::vector<std::pair<std::string, GLuint>>& blockBindings()
+	{
+		static std::vector<std::pair<std::string, GLuint>> bindings;
+		return bindings;
+	}
+
+	static unsigned int nextSerial()
+	{
+		static unsigned int counter = 0;
+		return ++counter;
+	}
+
+	// binds the program's uniform blocks, reads the active uniforms of the program into the table and resolves the handed out handles against it
+	void reflect()
+	{
+		for (const auto& binding : blockBindings())
+		{
+			GLuint index = ID != 0 ? glGetUniformBlockIndex(ID, binding.first.c_str()) : GL_INVALID_INDEX;
+			if (index != GL_INVALID_INDEX)
+				glUniformBlockBinding(ID, index, binding.second);
+		}
+
+		uniforms.clear();
+		GLint count = 0, maxLength = 0;
+		if (ID != 0)
+		{
+			glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+			glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		}
+
+		std::vector<GLchar> buffer(std::max(maxLength, 1));
+		for (GLint i = 0; i < count; i++)
+		{
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), nullptr, &size, &type, buffer.data());
+			std::string name(buffer.data());
+			// uniforms inside blocks have no location
+			GLint location = glGetUniformLocation(ID, name.c_str());
+			if (location < 0)
+				continue;
+
+			// arrays are reported once as "name[0]", each element gets its own entry and the bare name the first
+			size_t bracket = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0 ? name.size() - 3 : std::string::npos;
+			if (bracket == std::string::npos)
+			{
+				uniforms.push_back({ name, location, type });
+				continue;
+			}
+			std::string base = name.substr(0, bracket);
+			uniforms.push_back({ base, location, type });
+			for (GLint element = 0; element < size; element++)
+			{
+				std::string elementName = base + "[" + std::to_string(element) + "]";
+				uniforms.push_back({ elementName, glGetUniformLocation(ID, elementName.c_str()), type });
+			}
+		}
+		std::sort(uniforms.begin(), uniforms.end(), [](const UniformInfo& a, const UniformInfo& b) { return a.name < b.name; });
+
+		for (size_t i = 0; i < slotNames.size(); i++)
+			slotLocations[i] = GetLocation(slotNames[i]);
+	}
+
+	static bool readSource(const char* path, std::string& code)
+	{
+		AssetFile file;
+		if (!file.Open(path))
+			return false;
+		code.assign(reinterpret_cast<const char*>(file.Data()), file.Size());
+		return true;
+	}
+
+	// reads the source files and builds them, returns 0 if any step fails
+	// ------------------------------------------------------------------------
+	static unsigned int build(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+	{
+		ProfileScope scope("shader", vertexPath);
+		// 1. retrieve the vertex/fragment source code from filePath (or the mounted pak)
+		std::string vertexCode;
+		std::string fragmentCode;
+		std::string geometryCode;
+		if (!readSource(vertexPath, vertexCode) || !readSource(fragmentPath, fragmentCode) ||
+			(geometryPath != nullptr && !readSource(geometryPath, geometryCode)))
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+			return 0;
+		}
+		return compile(vertexCode.c_str(), fragmentCode.c_str(), geometryPath != nullptr ? geometryCode.c_str() : nullptr);
+	}
+
+	// compiles and links the sources, returns 0 if any step fails
+	// ------------------------------------------------------------------------
+	static unsigned int compile(const char* vShaderCode, const char* fShaderCode, const char* gShaderCode)
+	{
+		// 2. compile shaders
+		unsigned int vertex, fragment;
+		// vertex shader
+		vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertex, 1, &vShaderCode, NULL);
+		glCompileShader(vertex);
+		bool success = checkCompileErrors(vertex, "VERTEX");
+		// fragment Shader
+		fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragment, 1, &fShaderCode, NULL);
+		glCompileShader(fragment);
+		success = checkCompileErrors(fragment, "FRAGMENT") && success;
+		// if geometry shader is given, compile geometry shader
+		unsigned int geometry = 0;
+		if (gShaderCode != nullptr)
+		{
+			geometry = glCreateShader(GL_GEOMETRY_SHADER);
+			glShaderSource(geometry, 1, &gShaderCode, NULL);
+			glCompileShader(geometry);
+			success = checkCompileErrors(geometry, "GEOMETRY") && success;
+		}
+		// shader Program
+		unsigned int program = 0;
+		if (success)
+		{
+			program = glCreateProgram();
+			glAttachShader(program, vertex);
+			glAttachShader(program, fragment);
+			if (gShaderCode != nullptr)
+				glAttachShader(program, geometry);
+			glLinkProgram(program);
+			if (!checkCompileErrors(program, "PROGRAM"))
+			{
+				GLState::Get().DeleteProgram(program);
+				program = 0;
+			}
+		}
+		// delete the shaders as they're linked into our program now and no longer necessery
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		if (gShaderCode != nullptr)
+			glDeleteShader(geometry);
+		return program;
+	}
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(GLuint shader, std::string type)
+	static bool checkCompileErrors(GLuint shader, std::string type)
 	{
 		GLint success;
 		GLchar infoLog[1024];
@@ -185,5 +426,6 @@ private:
 				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 			}
 		}
+		return success != 0;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,598 @@
+#include "TextureCache.h"
+#include "GLState.h"
+#include "ThreadPool.h"
+#include "PakArchive.h"
+#include "Hash.h"
+#include "CookManifest.h"
+#include "FileSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+size_t TextureCache::vramBudget = (size_t)512 << 20;
+int TextureCache::streamingStartSize = 64;
+
+TextureCache& TextureCache::Get()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+TextureHandle TextureCache::Acquire(const string& path)
+{
+	string key = CanonicalPath(path);
+
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_byPath.find(key);
+	if (it != m_byPath.end())
+	{
+		TextureHandle existing = it->second.lock();
+		if (existing)
+			return existing;
+	}
+
+	return Create(key, GL_TEXTURE_2D, vector<string>(1, path));
+}
+
+TextureHandle TextureCache::AcquireCubemap(const vector<string>& faces)
+{
+	string key;
+	for (const string& face : faces)
+		key += CanonicalPath(face) + '|';
+
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_byPath.find(key);
+	if (it != m_byPath.end())
+	{
+		TextureHandle existing = it->second.lock();
+		if (existing)
+			return existing;
+	}
+
+	return Create(key, GL_TEXTURE_CUBE_MAP, faces);
+}
+
+TextureHandle TextureCache::Create(const string& key, GLenum target, const vector<string>& files)
+{
+	TextureHandle resource(new TextureResource, [this](TextureResource* r) { Release(r); });
+	resource->target = target;
+	resource->key = key;
+	m_byPath[key] = resource;
+	QueueDecode(resource, files);
+
+	return resource;
+}
+
+void TextureCache::QueueDecode(const TextureHandle& resource, const vector<string>& files)
+{
+	PendingLoad pending;
+	pending.resource = resource;
+	pending.files = files;
+	weak_ptr<TextureResource> weak = resource;
+	GLenum target = resource->target;
+	pending.result = ThreadPool::Get().Submit([this, weak, target, files]() { return Decode(weak, target, files); });
+	m_pending.push_back(std::move(pending));
+}
+
+// the files a texture is built from, recovered from its key
+static vector<string> SplitKey(const TextureResource& resource)
+{
+	vector<string> files;
+	if (resource.target != GL_TEXTURE_CUBE_MAP)
+	{
+		files.push_back(resource.key);
+		return files;
+	}
+
+	size_t start = 0, end;
+	while ((end = resource.key.find('|', start)) != string::npos)
+	{
+		files.push_back(resource.key.substr(start, end - start));
+		start = end + 1;
+	}
+	return files;
+}
+
+bool TextureCache::ReloadFile(const string& path)
+{
+	string key = CanonicalPath(path);
+
+	// declared outside the lock, dropping the last handle here would call Release which takes m_mutex again
+	vector<TextureHandle> live;
+	vector<TextureHandle> reloads;
+	lock_guard<mutex> lock(m_mutex);
+
+	for (auto& entry : m_byPath)
+	{
+		TextureHandle resource = entry.second.lock();
+		if (resource)
+			live.push_back(resource);
+	}
+	for (const TextureHandle& resource : live)
+	{
+		vector<string> files = SplitKey(*resource);
+		if (std::find(files.begin(), files.end(), key) != files.end())
+			reloads.push_back(resource);
+	}
+	if (reloads.empty())
+		return false;
+
+	// textures that were found to be duplicates of a reloaded one alias its texture object, they keep their
+	// own image so have to be decoded again as well
+	for (const TextureHandle& resource : live)
+		if (resource->alias && std::find(reloads.begin(), reloads.end(), resource->alias) != reloads.end() &&
+			std::find(reloads.begin(), reloads.end(), resource) == reloads.end())
+			reloads.push_back(resource);
+
+	for (const TextureHandle& resource : reloads)
+	{
+		// the content is about to change, so the old hash must no longer lead to this texture
+		{
+			lock_guard<mutex> hashLock(m_hashMutex);
+			auto hashed = m_byHash.find(resource->contentHash);
+			if (hashed != m_byHash.end() && !hashed->second.owner_before(resource) && !resource.owner_before(hashed->second))
+				m_byHash.erase(hashed);
+		}
+
+		// a decode still in flight would upload the old image after the new one
+		m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [&](const PendingLoad& load) { return load.resource == resource; }), m_pending.end());
+		QueueDecode(resource, SplitKey(*resource));
+	}
+	return true;
+}
+
+TextureCache::DecodeResult TextureCache::Decode(weak_ptr<TextureResource> resource, GLenum target, const vector<string>& files)
+{
+	ProfileScope scope("decode", files.empty() ? string() : files[0]);
+	DecodeResult result;
+
+	// open every file (from the pak when mounted) and hash the raw bytes, so duplicates can be skipped before paying for the decode.
+	// Cooked builds hash the keys from the manifest instead, which stand for the same bytes.
+	vector<unique_ptr<AssetFile>> mapped;
+	vector<CookManifest::Entry> cooked(files.size());
+	bool complete = true;
+	uint64_t hash = HashBytes(&target, sizeof(target));
+
+	// a 2D source with the size and write time its container was baked from isn't read at all, the container
+	// holds the hash its bytes had
+	unique_ptr<TextureContainer> stamped;
+	if (!CookManifest::cookedOnly && target == GL_TEXTURE_2D && files.size() == 1 && TextureContainer::GetSourceStamp(files[0], result.stamp))
+	{
+		stamped.reset(new TextureContainer());
+		if (stamped->Open(TextureContainer::GetContainerPath(files[0]), result.stamp))
+			hash = stamped->GetSourceHash();
+		else
+			stamped.reset();
+	}
+
+	for (size_t i = 0; i < files.size() && !stamped; i++)
+	{
+		if (CookManifest::cookedOnly)
+		{
+			if (CookManifest::Get().Find(files[i], cooked[i]))
+				hash = HashBytes(&cooked[i].key, sizeof(cooked[i].key), hash);
+			else
+				complete = false;
+			continue;
+		}
+
+		unique_ptr<AssetFile> map(new AssetFile());
+		if (map->Open(files[i]))
+			hash = HashBytes(map->Data(), map->Size(), hash);
+		else
+			complete = false;
+		mapped.push_back(std::move(map));
+	}
+
+	if (complete)
+	{
+		result.contentHash = hash;
+
+		lock_guard<mutex> lock(m_hashMutex);
+		auto it = m_byHash.find(hash);
+		// compare ownership only, locking the other texture here could make this thread its last owner
+		bool same = it != m_byHash.end() && !it->second.owner_before(resource) && !resource.owner_before(it->second);
+		if (it != m_byHash.end() && !it->second.expired() && !same)
+		{
+			result.duplicate = true;
+			return result;
+		}
+		m_byHash[hash] = resource;
+	}
+
+	if (stamped)
+	{
+		result.containers.push_back(std::move(stamped));
+		return result;
+	}
+
+	if (CookManifest::cookedOnly)
+	{
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			unique_ptr<TextureContainer> container(new TextureContainer());
+			if (cooked[i].path.empty() || !container->Open(cooked[i].path, cooked[i].key))
+			{
+				cout << "ERROR::TEXTURE_CACHE::NOT_COOKED " << files[i] << endl;
+				container.reset();
+			}
+			result.containers.push_back(std::move(container));
+		}
+		return result;
+	}
+
+	// a baked container skips the decode entirely
+	if (complete && target == GL_TEXTURE_2D)
+	{
+		unique_ptr<TextureContainer> container(new TextureContainer());
+		if (container->Open(TextureContainer::GetContainerPath(files[0]), hash))
+		{
+			result.containers.push_back(std::move(container));
+			return result;
+		}
+		result.bake = true;
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (mapped[i]->IsOpen())
+			result.images.push_back(DecodeImageFromMemory(mapped[i]->Data(), mapped[i]->Size(), files[i]));
+		else
+		{
+			DecodedImage missing;
+			missing.path = files[i];
+			result.images.push_back(missing);
+		}
+	}
+	return result;
+}
+
+void TextureCache::FinishLoads()
+{
+	DeleteReleased();
+
+	// uploads in request order, so later decodes keep running while earlier ones are being uploaded
+	while (true)
+	{
+		PendingLoad pending;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (m_pending.empty())
+				return;
+			pending = std::move(m_pending.front());
+			m_pending.pop_front();
+		}
+		Finish(pending);
+	}
+}
+
+void TextureCache::FinishLoads(const vector<TextureHandle>& textures)
+{
+	DeleteReleased();
+
+	vector<TextureHandle> waiting(textures);
+	while (!waiting.empty())
+	{
+		TextureHandle texture = waiting.back();
+		waiting.pop_back();
+
+		PendingLoad pending;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			auto found = std::find_if(m_pending.begin(), m_pending.end(), [&](const PendingLoad& load) { return load.resource == texture; });
+			if (found == m_pending.end())
+				continue;
+			pending = std::move(*found);
+			m_pending.erase(found);
+		}
+		Finish(pending);
+
+		// a duplicate takes the texture object of another path, which may still be loading itself
+		if (texture->alias && !texture->alias->IsResident())
+			waiting.push_back(texture->alias);
+	}
+}
+
+size_t TextureCache::PumpLoads(chrono::steady_clock::time_point deadline, size_t maxBytes)
+{
+	DeleteReleased();
+
+	size_t bytes = 0;
+	while (bytes < maxBytes && chrono::steady_clock::now() < deadline)
+	{
+		// take the first decode that is already done, never wait for one
+		PendingLoad pending;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			auto ready = std::find_if(m_pending.begin(), m_pending.end(), [](const PendingLoad& load)
+			{
+				return load.result.wait_for(chrono::seconds(0)) == future_status::ready;
+			});
+			if (ready == m_pending.end())
+				break;
+			pending = std::move(*ready);
+			m_pending.erase(ready);
+		}
+		bytes += Finish(pending);
+	}
+	return bytes;
+}
+
+size_t TextureCache::GetTextureCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_byPath.size();
+}
+
+size_t TextureCache::GetPendingCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_pending.size();
+}
+
+size_t TextureCache::Finish(PendingLoad& pending)
+{
+	TextureResource& resource = *pending.resource;
+	DecodeResult result = pending.result.get();
+	ProfileScope scope("upload", resource.key);
+	resource.contentHash = result.contentHash;
+	// set when this is a reload, the old texture object is replaced by the new one, and with it its levels
+	unsigned int previous = resource.id;
+	m_residentBytes -= resource.residentBytes;
+	resource.residentBytes = 0;
+	StopStreaming(resource);
+
+	if (result.duplicate)
+	{
+		TextureHandle original;
+		{
+			lock_guard<mutex> lock(m_hashMutex);
+			auto it = m_byHash.find(result.contentHash);
+			if (it != m_byHash.end())
+				original = it->second.lock();
+		}
+
+		if (original)
+		{
+			// same image under another path: share the original's texture object instead of creating one
+			resource.alias = original;
+			resource.resident = true;
+			resource.id = 0;
+			if (previous != 0)
+				GLState::Get().DeleteTextures(1, &previous);
+			return 0;
+		}
+
+		// the original was released in the meantime, decode it here after all
+		result = Decode(pending.resource, resource.target, pending.files);
+	}
+
+	glGenTextures(1, &resource.id);
+	resource.resident = true;
+	resource.alias.reset();
+	if (previous != 0)
+		GLState::Get().DeleteTextures(1, &previous);
+
+	size_t bytes = 0;
+	if (!result.containers.empty())
+	{
+		if (resource.target == GL_TEXTURE_2D && result.containers[0])
+			bytes = StartStreaming(resource, std::move(result.containers[0]));
+
+		for (size_t i = 0; i < result.containers.size() && resource.target == GL_TEXTURE_CUBE_MAP; i++)
+		{
+			const unique_ptr<TextureContainer>& container = result.containers[i];
+			if (!container)
+				continue;
+			container->Upload(resource.id, GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i);
+			bytes += container->GetUploadSize();
+		}
+		resource.residentBytes = bytes;
+		m_residentBytes += bytes;
+		return bytes;
+	}
+
+	if (resource.target == GL_TEXTURE_CUBE_MAP)
+		UploadCubemap(resource.id, result.images);
+	else if (!result.images.empty())
+		UploadTexture2D(resource.id, result.images[0]);
+
+	for (auto& image : result.images)
+	{
+		bytes += (size_t)image.width * image.height * image.components;
+		if (result.bake && image.data)
+		{
+			// the bake task takes over the pixels and frees them once the container is written
+			DecodedImage source = image;
+			uint64_t hash = result.contentHash;
+			TextureContainer::SourceStamp stamp = result.stamp;
+			ThreadPool::Get().Submit([source, hash, stamp]() mutable
+			{
+				ProfileScope scope("bake", source.path);
+				TextureContainer::Bake(TextureContainer::GetContainerPath(source.path), hash, source.data,
+					source.width, source.height, source.components, TextureContainer::ChooseFormat(source.components), stamp);
+				FreeImage(source);
+			});
+		}
+		else
+			FreeImage(image);
+	}
+	// decoded images upload in full, 2D ones with a generated mip chain
+	resource.residentBytes = resource.target == GL_TEXTURE_2D ? bytes + bytes / 3 : bytes;
+	m_residentBytes += resource.residentBytes;
+	return bytes;
+}
+
+size_t TextureCache::StartStreaming(TextureResource& resource, unique_ptr<TextureContainer> container)
+{
+	// the small end of the chain goes up straight away, the rest follows as the texture is seen up close
+	const vector<TextureContainer::Level>& levels = container->GetLevels();
+	unsigned int first = 0;
+	while (first + 1 < levels.size() && max(levels[first].width, levels[first].height) > streamingStartSize)
+		first++;
+
+	container->Upload(resource.id, GL_TEXTURE_2D, first);
+	resource.residentLevel = first;
+	resource.coarsestLevel = first;
+	resource.demand = 0;
+	resource.container = std::move(container);
+	if (first > 0)
+		m_streamed.push_back(&resource);
+	return resource.container->GetUploadSize(first);
+}
+
+void TextureCache::StopStreaming(TextureResource& resource)
+{
+	m_streamed.erase(std::remove(m_streamed.begin(), m_streamed.end(), &resource), m_streamed.end());
+	resource.container.reset();
+	resource.residentLevel = 0;
+	resource.coarsestLevel = 0;
+}
+
+size_t TextureCache::EvictLevel(TextureResource& resource)
+{
+	// GL can't drop a level from a texture object, so the smaller chain is uploaded into a new one
+	unsigned int id;
+	glGenTextures(1, &id);
+	resource.container->Upload(id, GL_TEXTURE_2D, resource.residentLevel + 1);
+	GLState::Get().DeleteTextures(1, &resource.id);
+	resource.id = id;
+	resource.residentLevel++;
+
+	size_t bytes = resource.container->GetUploadSize(resource.residentLevel);
+	m_residentBytes -= resource.residentBytes - bytes;
+	resource.residentBytes = bytes;
+	return bytes;
+}
+
+void TextureCache::RequestDetail(const TextureHandle& handle, float pixelsPerUv)
+{
+	TextureResource* resource = handle.get();
+	while (resource && resource->alias)
+		resource = resource->alias.get();
+	if (!resource || !resource->container)
+		return;
+
+	if (resource->lastVisibleFrame != m_frame)
+		resource->demand = 0;
+	resource->lastVisibleFrame = m_frame;
+	resource->demand = max(resource->demand, pixelsPerUv);
+}
+
+size_t TextureCache::UpdateStreaming(chrono::steady_clock::time_point deadline, size_t maxBytes)
+{
+	DeleteReleased();
+
+	// the level whose texel density matches the requested screen density, one texel per pixel
+	auto wantedLevel = [](const TextureResource& resource)
+	{
+		const TextureContainer::Level& top = resource.container->GetLevels()[0];
+		float texels = (float)max(top.width, top.height);
+		if (resource.demand <= 0)
+			return resource.coarsestLevel;
+		float level = floor(log2(texels / resource.demand));
+		return (unsigned int)min(max(level, 0.f), (float)resource.coarsestLevel);
+	};
+
+	// textures visible this frame that are sampled too coarsely, the largest shortfall first
+	vector<pair<unsigned int, TextureResource*>> upgrades;
+	for (TextureResource* resource : m_streamed)
+	{
+		if (resource->lastVisibleFrame != m_frame)
+			continue;
+		unsigned int wanted = wantedLevel(*resource);
+		if (wanted < resource->residentLevel)
+			upgrades.push_back(make_pair(resource->residentLevel - wanted, resource));
+	}
+	std::stable_sort(upgrades.begin(), upgrades.end(), [](const pair<unsigned int, TextureResource*>& a, const pair<unsigned int, TextureResource*>& b)
+	{
+		return a.first > b.first;
+	});
+
+	// the texture not seen for the longest that still has a level to give up, never one visible this frame
+	auto leastRecentlyVisible = [this]() -> TextureResource*
+	{
+		TextureResource* victim = nullptr;
+		for (TextureResource* resource : m_streamed)
+			if (resource->lastVisibleFrame != m_frame && resource->residentLevel < resource->coarsestLevel &&
+				(!victim || resource->lastVisibleFrame < victim->lastVisibleFrame))
+				victim = resource;
+		return victim;
+	};
+
+	size_t bytes = 0;
+	for (auto& upgrade : upgrades)
+	{
+		if (bytes >= maxBytes || chrono::steady_clock::now() >= deadline)
+			break;
+
+		TextureResource& resource = *upgrade.second;
+		unsigned int level = resource.residentLevel - 1;
+		size_t cost = resource.container->GetUploadSize(level) - resource.residentBytes;
+
+		// make room by evicting, stops once only visible textures are left. Every eviction uploads the remaining
+		// chain again, so it counts against the frame's budget like an upgrade.
+		TextureResource* victim = nullptr;
+		while (m_residentBytes + cost > vramBudget && bytes < maxBytes && chrono::steady_clock::now() < deadline &&
+			(victim = leastRecentlyVisible()))
+			bytes += EvictLevel(*victim);
+		if (m_residentBytes + cost > vramBudget)
+			break;
+
+		ProfileScope scope("stream", resource.key);
+		resource.container->UploadLevel(resource.id, level);
+		resource.residentLevel = level;
+		resource.residentBytes += cost;
+		m_residentBytes += cost;
+		bytes += cost;
+	}
+
+	// a lowered budget or fully uploaded textures can leave the total above it without any upgrade
+	TextureResource* victim = nullptr;
+	while (m_residentBytes > vramBudget && bytes < maxBytes && chrono::steady_clock::now() < deadline &&
+		(victim = leastRecentlyVisible()))
+		bytes += EvictLevel(*victim);
+
+	m_frame++;
+	return bytes;
+}
+
+void TextureCache::Release(TextureResource* resource)
+{
+	{
+		lock_guard<mutex> lock(m_hashMutex);
+		auto hashed = m_byHash.find(resource->contentHash);
+		if (hashed != m_byHash.end() && hashed->second.expired())
+			m_byHash.erase(hashed);
+	}
+
+	// the last handle may go away on any thread, the streaming list and the texture object belong to the GL thread
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_byPath.find(resource->key);
+	if (it != m_byPath.end() && it->second.expired())
+		m_byPath.erase(it);
+	m_released.push_back(resource);
+}
+
+void TextureCache::DeleteReleased()
+{
+	vector<TextureResource*> released;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		released.swap(m_released);
+	}
+
+	for (TextureResource* resource : released)
+	{
+		StopStreaming(*resource);
+		m_residentBytes -= resource->residentBytes;
+
+		// aliases never create a texture object of their own
+		if (resource->id != 0)
+			GLState::Get().DeleteTextures(1, &resource->id);
+
+		delete resource;
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "TextureLoader.h"
+#include "TextureContainer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// A GL texture shared by everything that references the same image. Handles are reference counted,
+// the texture is deleted when the last handle goes away.
+struct TextureResource {
+	unsigned int id = 0;		// created on the GL thread when the decoded image is uploaded
+	GLenum target = GL_TEXTURE_2D;
+	string key;					// canonical path (or joined face paths for cubemaps)
+	uint64_t contentHash = 0;
+	bool resident = false;		// true once the image data has been uploaded
+	shared_ptr<TextureResource> alias;	// set when another path turned out to hold the same image, which is used instead
+	size_t residentBytes = 0;	// GPU memory the texture object holds
+
+	// mip streaming, only for 2D textures loaded from a container, which stays mapped to upload further levels from
+	unique_ptr<TextureContainer> container;
+	unsigned int residentLevel = 0;	// finest level on the GPU
+	unsigned int coarsestLevel = 0;	// the level uploaded first, never evicted
+	float demand = 0;				// screen pixels per UV unit requested this frame
+	uint64_t lastVisibleFrame = 0;
+
+	unsigned int GetID() const { return alias ? alias->GetID() : id; }
+	bool IsResident() const { return alias ? alias->IsResident() : resident; }
+};
+typedef shared_ptr<TextureResource> TextureHandle;
+
+// Process wide texture registry. Lookups by canonical path are O(1); images that are byte identical under
+// different paths are detected through their content hash and share a single GL texture as well.
+// 2D textures load from their baked TextureContainer when it matches the image, otherwise the image is decoded
+// and a container is baked in the background for the next run. With CookManifest::cookedOnly every texture,
+// cubemap faces included, loads from its cooked container and the image files are never read.
+// Acquire may be called from any thread (loaders acquire while parsing) and handles may be released on any
+// thread, released textures are only queued and are destroyed on the GL thread by the next FinishLoads, PumpLoads
+// or UpdateStreaming. Everything else is GL thread only.
+class TextureCache
+{
+public:
+	static TextureCache& Get();
+
+	// returns the texture for an image file, queueing its decode on the thread pool on first use
+	TextureHandle Acquire(const string& path);
+	// returns the cubemap built from six face images (+X, -X, +Y, -Y, +Z, -Z)
+	TextureHandle AcquireCubemap(const vector<string>& faces);
+
+	// GL thread: waits for every queued decode and uploads it, and deletes the textures released since the last call
+	void FinishLoads();
+	// GL thread: waits for the decodes of the given textures only and uploads them, other loads stay queued
+	void FinishLoads(const vector<TextureHandle>& textures);
+	// GL thread: uploads decodes that have already finished until the deadline or byte budget is used up,
+	// returns the number of bytes uploaded. Deletes the textures released since the last call first.
+	size_t PumpLoads(chrono::steady_clock::time_point deadline, size_t maxBytes);
+
+	// GL thread: decodes every live texture built from the file again. The old texture object stays in use until
+	// the new image is uploaded by FinishLoads/PumpLoads, which swaps it in place. Returns whether any texture
+	// uses the file.
+	bool ReloadFile(const string& path);
+
+	// GL thread: the texture is visible this frame and is sampled at up to pixelsPerUv screen pixels per UV unit
+	void RequestDetail(const TextureHandle& handle, float pixelsPerUv);
+	// GL thread, once per frame after PumpLoads: uploads the next finer level of the textures that are sampled
+	// too coarsely, most undersampled first, and drops the finest levels of the least recently visible ones
+	// to stay within vramBudget. Destroys the textures released since the last call first. Returns the number of
+	// bytes uploaded.
+	size_t UpdateStreaming(chrono::steady_clock::time_point deadline, size_t maxBytes);
+
+	size_t GetTextureCount();
+	size_t GetPendingCount();
+	size_t GetResidentBytes() const { return m_residentBytes; }
+
+	// GPU memory textures may use, streamed levels are evicted to stay below it
+	static size_t vramBudget;
+	// streamed textures start out resident from the first level at most this many texels across
+	static int streamingStartSize;
+
+private:
+	TextureCache() {}
+
+	struct DecodeResult {
+		vector<DecodedImage> images;
+		vector<unique_ptr<TextureContainer>> containers;	// baked mip chains, one per file, used instead of images when up to date
+		uint64_t contentHash = 0;
+		bool duplicate = false;	// the hash matched another live texture, nothing was decoded
+		bool bake = false;		// no up to date container exists, bake one from the decoded image
+		TextureContainer::SourceStamp stamp;	// of the 2D source file as it was read, recorded in the baked container
+	};
+
+	struct PendingLoad {
+		TextureHandle resource;
+		vector<string> files;
+		future<DecodeResult> result;
+	};
+
+	TextureHandle Create(const string& key, GLenum target, const vector<string>& files);
+	void QueueDecode(const TextureHandle& resource, const vector<string>& files);	// m_mutex must be held
+	DecodeResult Decode(weak_ptr<TextureResource> resource, GLenum target, const vector<string>& files);
+	size_t Finish(PendingLoad& pending);
+	void Release(TextureResource* resource);
+	void DeleteReleased();
+	size_t StartStreaming(TextureResource& resource, unique_ptr<TextureContainer> container);
+	size_t EvictLevel(TextureResource& resource);
+	void StopStreaming(TextureResource& resource);
+
+	unordered_map<string, weak_ptr<TextureResource>> m_byPath;	// guarded by m_mutex
+	deque<PendingLoad> m_pending;								// guarded by m_mutex
+	vector<TextureResource*> m_released;						// waiting to be destroyed on the GL thread, guarded by m_mutex
+	mutex m_mutex;
+	unordered_map<uint64_t, weak_ptr<TextureResource>> m_byHash;	// shared with the decode tasks, guarded by m_hashMutex
+	mutex m_hashMutex;
+
+	// GL thread only. A released resource stays in m_streamed until DeleteReleased, so the pointers never dangle.
+	vector<TextureResource*> m_streamed;
+	uint64_t m_frame = 1;
+	size_t m_residentBytes = 0;
+};
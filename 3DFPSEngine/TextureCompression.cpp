@@ -0,0 +1,333 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static int BlocksAcross(int size)
+{
+	return std::max(1, (size + 3) / 4);
+}
+
+size_t GetCompressedSize(BlockFormat format, int width, int height)
+{
+	size_t blocks = (size_t)BlocksAcross(width) * BlocksAcross(height);
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC4:
+		return blocks * 8;
+	case BlockFormat::BC3:
+	case BlockFormat::BC5:
+		return blocks * 16;
+	default:
+		return (size_t)width * height * 4;
+	}
+}
+
+// reads the 4x4 block at (bx, by) as RGBA, clamping at the image edges
+static void FetchBlock(const unsigned char* pixels, int width, int height, int components, int bx, int by, unsigned char block[16][4])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int sy = std::min(by * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++)
+		{
+			int sx = std::min(bx * 4 + x, width - 1);
+			const unsigned char* src = pixels + ((size_t)sy * width + sx) * components;
+			unsigned char* dst = block[y * 4 + x];
+			dst[0] = src[0];
+			dst[1] = components > 1 ? src[1] : 0;
+			dst[2] = components > 2 ? src[2] : 0;
+			dst[3] = components > 3 ? src[3] : 255;
+		}
+	}
+}
+
+static uint16_t PackRGB565(const float color[3])
+{
+	int r = (int)std::lround(std::min(std::max(color[0], 0.f), 255.f) * 31.f / 255.f);
+	int g = (int)std::lround(std::min(std::max(color[1], 0.f), 255.f) * 63.f / 255.f);
+	int b = (int)std::lround(std::min(std::max(color[2], 0.f), 255.f) * 31.f / 255.f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int color[3])
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 colour block: endpoints along the principal axis of the block's colours, always in 4 colour mode
+static void EncodeColorBlock(const unsigned char block[16][4], unsigned char* out)
+{
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += block[i][c] / 16.f;
+
+	float cov[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+		cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+	}
+
+	// a few power iterations are plenty to find the dominant axis of 16 points
+	float axis[3] = { 1, 1, 1 };
+	for (int iteration = 0; iteration < 4; iteration++)
+	{
+		float next[3] = {
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+		};
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float lo = 0, hi = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+		lo = std::min(lo, t);
+		hi = std::max(hi, t);
+	}
+	// pull the endpoints in slightly, the interpolated colours cover the range better that way
+	float inset = (hi - lo) / 16.f;
+	lo += inset;
+	hi -= inset;
+
+	float maxColor[3], minColor[3];
+	for (int c = 0; c < 3; c++)
+	{
+		maxColor[c] = mean[c] + axis[c] * hi;
+		minColor[c] = mean[c] + axis[c] * lo;
+	}
+
+	uint16_t c0 = PackRGB565(maxColor);
+	uint16_t c1 = PackRGB565(minColor);
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		int palette[4][3];
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				int error = dr * dr + dg * dg + db * db;
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	out[0] = (unsigned char)(c0 & 0xff);
+	out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)(c1 & 0xff);
+	out[3] = (unsigned char)(c1 >> 8);
+	for (int b = 0; b < 4; b++)
+		out[4 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+// BC4 block (also the alpha half of BC3): 8 interpolated values between the block's min and max
+static void EncodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char* out)
+{
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		lo = std::min(lo, (int)block[i][channel]);
+		hi = std::max(hi, (int)block[i][channel]);
+	}
+
+	uint64_t indices = 0;
+	if (hi != lo)
+	{
+		int palette[8];
+		palette[0] = hi;
+		palette[1] = lo;
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs(block[i][channel] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)hi;
+	out[1] = (unsigned char)lo;
+	for (int b = 0; b < 6; b++)
+		out[2 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+std::vector<unsigned char> CompressImage(BlockFormat format, const unsigned char* pixels, int width, int height, int components)
+{
+	std::vector<unsigned char> result(GetCompressedSize(format, width, height));
+
+	if (format == BlockFormat::RGBA8)
+	{
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			const unsigned char* src = pixels + i * components;
+			result[i * 4 + 0] = src[0];
+			result[i * 4 + 1] = components > 1 ? src[1] : 0;
+			result[i * 4 + 2] = components > 2 ? src[2] : 0;
+			result[i * 4 + 3] = components > 3 ? src[3] : 255;
+		}
+		return result;
+	}
+
+	unsigned char* out = result.data();
+	unsigned char block[16][4];
+	for (int by = 0; by < BlocksAcross(height); by++)
+	{
+		for (int bx = 0; bx < BlocksAcross(width); bx++)
+		{
+			FetchBlock(pixels, width, height, components, bx, by, block);
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				EncodeColorBlock(block, out);
+				out += 8;
+				break;
+			case BlockFormat::BC3:
+				EncodeChannelBlock(block, 3, out);
+				EncodeColorBlock(block, out + 8);
+				out += 16;
+				break;
+			case BlockFormat::BC4:
+				EncodeChannelBlock(block, 0, out);
+				out += 8;
+				break;
+			case BlockFormat::BC5:
+				EncodeChannelBlock(block, 0, out);
+				EncodeChannelBlock(block, 1, out + 8);
+				out += 16;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+static void DecodeColorBlock(const unsigned char* in, unsigned char block[16][4])
+{
+	uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+	uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+	int palette[4][4];
+	UnpackRGB565(c0, palette[0]);
+	UnpackRGB565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for (int c = 0; c < 3; c++)
+	{
+		if (c0 > c1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if (c0 <= c1)
+		palette[3][3] = 0;
+
+	uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (indices >> (i * 2)) & 3;
+		for (int c = 0; c < 4; c++)
+			block[i][c] = (unsigned char)palette[index][c];
+	}
+}
+
+static void DecodeChannelBlock(const unsigned char* in, int channel, unsigned char block[16][4])
+{
+	int palette[8];
+	palette[0] = in[0];
+	palette[1] = in[1];
+	if (palette[0] > palette[1])
+	{
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * palette[0] + p * palette[1]) / 7;
+	}
+	else
+	{
+		for (int p = 1; p < 5; p++)
+			palette[p + 1] = ((5 - p) * palette[0] + p * palette[1]) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int b = 0; b < 6; b++)
+		indices |= (uint64_t)in[2 + b] << (b * 8);
+	for (int i = 0; i < 16; i++)
+		block[i][channel] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+}
+
+std::vector<unsigned char> DecompressToRGBA8(BlockFormat format, const unsigned char* blocks, int width, int height)
+{
+	std::vector<unsigned char> result((size_t)width * height * 4);
+	size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+
+	unsigned char block[16][4];
+	for (int by = 0; by < BlocksAcross(height); by++)
+	{
+		for (int bx = 0; bx < BlocksAcross(width); bx++)
+		{
+			if (format == BlockFormat::BC3)
+			{
+				DecodeColorBlock(blocks + 8, block);
+				DecodeChannelBlock(blocks, 3, block);
+			}
+			else
+				DecodeColorBlock(blocks, block);
+			blocks += blockSize;
+
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+					memcpy(&result[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], block[y * 4 + x], 4);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Block compression formats used by the baked texture container. BC4/BC5 (RGTC) are core since GL 3.0,
+// BC1/BC3 need EXT_texture_compression_s3tc and are decoded on the CPU where that is missing.
+enum class BlockFormat : uint32_t {
+	RGBA8 = 0,	// uncompressed fallback
+	BC1 = 1,	// RGB, 8 bytes per 4x4 block
+	BC3 = 2,	// RGBA, 16 bytes per 4x4 block
+	BC4 = 3,	// R, 8 bytes per 4x4 block
+	BC5 = 4		// RG, 16 bytes per 4x4 block
+};
+
+// bytes needed to store a width x height image in the given format
+size_t GetCompressedSize(BlockFormat format, int width, int height);
+
+// compresses an image with 1-4 interleaved 8 bit channels, edge blocks are padded by clamping
+std::vector<unsigned char> CompressImage(BlockFormat format, const unsigned char* pixels, int width, int height, int components);
+
+// expands BC1/BC3 data to RGBA8, used when the driver can't sample S3TC textures
+std::vector<unsigned char> DecompressToRGBA8(BlockFormat format, const unsigned char* blocks, int width, int height);
@@ -0,0 +1,349 @@
+#include "TextureContainer.h"
+#include "FileSystem.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// S3TC enums aren't part of the core profile loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// On-disk layout: header | level records | (16 byte aligned) level data, largest level first
+struct TextureContainerHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint32_t format;
+	uint32_t components;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t reserved;
+};
+
+struct TextureContainerLevel {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+static const char TEXTURE_CONTAINER_MAGIC[4] = { 'T', 'E', 'X', 'C' };
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 2x2 box filter, odd edges reuse the last row/column
+static std::vector<unsigned char> Downsample(const std::vector<unsigned char>& src, int width, int height, int components, int& outWidth, int& outHeight)
+{
+	outWidth = std::max(1, width / 2);
+	outHeight = std::max(1, height / 2);
+	std::vector<unsigned char> dst((size_t)outWidth * outHeight * components);
+
+	for (int y = 0; y < outHeight; y++)
+	{
+		int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < outWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < components; c++)
+			{
+				int sum = src[((size_t)y0 * width + x0) * components + c] + src[((size_t)y0 * width + x1) * components + c] +
+					src[((size_t)y1 * width + x0) * components + c] + src[((size_t)y1 * width + x1) * components + c];
+				dst[((size_t)y * outWidth + x) * components + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+BlockFormat TextureContainer::ChooseFormat(int components)
+{
+	switch (components)
+	{
+	case 1:
+		return BlockFormat::BC4;
+	case 2:
+		return BlockFormat::BC5;
+	case 3:
+		return BlockFormat::BC1;
+	default:
+		return BlockFormat::BC3;
+	}
+}
+
+bool TextureContainer::GetSourceStamp(const std::string& sourcePath, SourceStamp& stamp)
+{
+	if (PakArchive::Get().Contains(sourcePath))
+		return false;
+	return GetFileSize(sourcePath, stamp.size) && GetModificationTime(sourcePath, stamp.time) && stamp.size > 0;
+}
+
+bool TextureContainer::Bake(const std::string& containerPath, uint64_t sourceHash, const unsigned char* pixels, int width, int height, int components, BlockFormat format,
+	const SourceStamp& stamp)
+{
+	if (!pixels || width <= 0 || height <= 0 || components < 1 || components > 4)
+		return false;
+
+	// compress every level of the mip chain down to 1x1
+	std::vector<std::vector<unsigned char>> levels;
+	std::vector<TextureContainerLevel> records;
+	std::vector<unsigned char> current(pixels, pixels + (size_t)width * height * components);
+	int levelWidth = width, levelHeight = height;
+	while (true)
+	{
+		TextureContainerLevel record;
+		record.width = levelWidth;
+		record.height = levelHeight;
+		levels.push_back(CompressImage(format, current.data(), levelWidth, levelHeight, components));
+		record.size = levels.back().size();
+		records.push_back(record);
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		current = Downsample(current, levelWidth, levelHeight, components, levelWidth, levelHeight);
+	}
+
+	TextureContainerHeader header;
+	memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, 4);
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = stamp.size;
+	header.sourceTime = stamp.time;
+	header.format = (uint32_t)format;
+	header.components = components;
+	header.width = width;
+	header.height = height;
+	header.levelCount = (uint32_t)records.size();
+	header.reserved = 0;
+
+	size_t offset = sizeof(header) + records.size() * sizeof(TextureContainerLevel);
+	for (auto& record : records)
+	{
+		offset = AlignUp(offset, 16);
+		record.offset = offset;
+		offset += (size_t)record.size;
+	}
+
+	std::vector<unsigned char> file(offset, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	memcpy(&file[sizeof(header)], records.data(), records.size() * sizeof(TextureContainerLevel));
+	for (size_t i = 0; i < records.size(); i++)
+		memcpy(&file[(size_t)records[i].offset], levels[i].data(), levels[i].size());
+
+	// write to a temporary file first so a crash never leaves a half written container behind
+	std::string tempPath = containerPath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(file.data()), file.size());
+		if (!out)
+		{
+			std::cout << "ERROR::TEXTURE_CONTAINER::COULD_NOT_WRITE " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(containerPath.c_str());
+	if (std::rename(tempPath.c_str(), containerPath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		std::cout << "ERROR::TEXTURE_CONTAINER::COULD_NOT_WRITE " << containerPath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureContainer::Open(const std::string& containerPath, uint64_t sourceHash)
+{
+	if (open(containerPath) && m_sourceHash == sourceHash)
+		return true;
+	Close();
+	return false;
+}
+
+bool TextureContainer::Open(const std::string& containerPath, const SourceStamp& stamp)
+{
+	if (stamp.size != 0 && open(containerPath) && m_stamp.size == stamp.size && m_stamp.time == stamp.time)
+		return true;
+	Close();
+	return false;
+}
+
+bool TextureContainer::open(const std::string& containerPath)
+{
+	Close();
+
+	if (!m_file.Open(containerPath))
+		return false;
+
+	const unsigned char* data = m_file.Data();
+	size_t size = m_file.Size();
+
+	TextureContainerHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, TEXTURE_CONTAINER_MAGIC, 4) != 0 || header.version != VERSION ||
+		header.format > (uint32_t)BlockFormat::BC5 || header.levelCount == 0 || header.levelCount > 32 ||
+		size < sizeof(header) + header.levelCount * sizeof(TextureContainerLevel))
+	{
+		Close();
+		return false;
+	}
+
+	m_format = (BlockFormat)header.format;
+	m_components = (int)header.components;
+	m_sourceHash = header.sourceHash;
+	m_stamp.size = header.sourceSize;
+	m_stamp.time = header.sourceTime;
+
+	const TextureContainerLevel* records = reinterpret_cast<const TextureContainerLevel*>(data + sizeof(header));
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		const TextureContainerLevel& record = records[i];
+		if (record.offset > size || record.size > size - record.offset ||
+			record.size != GetCompressedSize(m_format, (int)record.width, (int)record.height))
+		{
+			Close();
+			return false;
+		}
+
+		Level level;
+		level.width = (int)record.width;
+		level.height = (int)record.height;
+		level.data = data + record.offset;
+		level.size = (size_t)record.size;
+		m_levels.push_back(level);
+	}
+
+	return true;
+}
+
+void TextureContainer::Close()
+{
+	m_levels.clear();
+	m_sourceHash = 0;
+	m_stamp = SourceStamp();
+	m_file.Close();
+}
+
+// whether the driver can sample BC1/BC3 directly, queried once on the GL thread
+static bool HasS3TC()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		supported = 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+				supported = 1;
+		}
+	}
+	return supported == 1;
+}
+
+unsigned int TextureContainer::getInternalFormat() const
+{
+	switch (m_format)
+	{
+	case BlockFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case BlockFormat::BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	default:
+		return GL_RGBA;
+	}
+}
+
+bool TextureContainer::isExpanded() const
+{
+	bool s3tc = m_format == BlockFormat::BC1 || m_format == BlockFormat::BC3;
+	return m_format == BlockFormat::RGBA8 || (s3tc && !HasS3TC());
+}
+
+void TextureContainer::uploadLevel(unsigned int target, unsigned int level) const
+{
+	const Level& data = m_levels[level];
+	if (m_format == BlockFormat::RGBA8)
+		glTexImage2D(target, (GLint)level, GL_RGBA, data.width, data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data);
+	else if (isExpanded())
+	{
+		std::vector<unsigned char> rgba = DecompressToRGBA8(m_format, data.data, data.width, data.height);
+		glTexImage2D(target, (GLint)level, GL_RGBA, data.width, data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+	}
+	else
+		glCompressedTexImage2D(target, (GLint)level, getInternalFormat(), data.width, data.height, 0, (GLsizei)data.size, data.data);
+}
+
+size_t TextureContainer::GetUploadSize(unsigned int firstLevel) const
+{
+	size_t bytes = 0;
+	for (size_t i = firstLevel; i < m_levels.size(); i++)
+		bytes += isExpanded() ? (size_t)m_levels[i].width * m_levels[i].height * 4 : m_levels[i].size;
+	return bytes;
+}
+
+bool TextureContainer::Upload(unsigned int textureID, unsigned int target, unsigned int firstLevel) const
+{
+	if (m_levels.empty())
+		return false;
+	firstLevel = std::min(firstLevel, (unsigned int)m_levels.size() - 1);
+
+	bool face = target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+	GLenum bindTarget = face ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+
+	GLState::Get().BindTexture(bindTarget, textureID);
+	for (unsigned int i = firstLevel; i < m_levels.size(); i++)
+		uploadLevel(target, i);
+
+	// cubemaps are sampled across face edges, so they clamp instead of repeating
+	GLint wrap = face ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glTexParameteri(bindTarget, GL_TEXTURE_BASE_LEVEL, (GLint)firstLevel);
+	glTexParameteri(bindTarget, GL_TEXTURE_MAX_LEVEL, (GLint)m_levels.size() - 1);
+	glTexParameteri(bindTarget, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(bindTarget, GL_TEXTURE_WRAP_T, wrap);
+	if (face)
+		glTexParameteri(bindTarget, GL_TEXTURE_WRAP_R, wrap);
+	glTexParameteri(bindTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(bindTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return true;
+}
+
+bool TextureContainer::UploadLevel(unsigned int textureID, unsigned int level) const
+{
+	if (level >= m_levels.size())
+		return false;
+
+	// levels below the base are already complete, so the texture stays usable throughout
+	GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
+	uploadLevel(GL_TEXTURE_2D, level);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+	return true;
+}
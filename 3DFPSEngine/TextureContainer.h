@@ -0,0 +1,82 @@
+#pragma once
+
+#include "PakArchive.h"
+#include "TextureCompression.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked texture with every mip level precomputed and block compressed, stored next to the source image as
+// <image>.texcache. Loading it is a single mmap plus one glCompressedTexImage2D per level, no PNG decode and
+// no glGenerateMipmap.
+class TextureContainer
+{
+public:
+	// bump whenever the file layout or the encoder output changes
+	static const uint32_t VERSION = 2;
+
+	// size and write time of the source image when the container was baked, lets a load skip reading an unchanged
+	// source. Zero when unknown, which never matches.
+	struct SourceStamp {
+		uint64_t size;
+		int64_t time;
+		SourceStamp() : size(0), time(0) {}
+	};
+
+	struct Level {
+		int width;
+		int height;
+		const unsigned char* data;	// points into the mapped file
+		size_t size;
+	};
+
+	static std::string GetContainerPath(const std::string& sourcePath) { return sourcePath + ".texcache"; }
+
+	// the stamp of a loose source file, false if it can't be read or the mounted pak provides the file instead
+	static bool GetSourceStamp(const std::string& sourcePath, SourceStamp& stamp);
+
+	// picks the block format for an image with the given channel count: BC4 for 1, BC5 for 2, BC1 for 3 and BC3 for 4
+	static BlockFormat ChooseFormat(int components);
+
+	// builds the mip chain, compresses every level and writes the container, safe to call from any thread
+	static bool Bake(const std::string& containerPath, uint64_t sourceHash, const unsigned char* pixels, int width, int height, int components, BlockFormat format,
+		const SourceStamp& stamp = SourceStamp());
+
+	// maps the container and validates it against the source image hash, returns false if missing, stale or corrupt
+	bool Open(const std::string& containerPath, uint64_t sourceHash);
+	// maps the container and validates it against the stamp of the source, without reading the source. On success
+	// GetSourceHash is the hash the source had when baked.
+	bool Open(const std::string& containerPath, const SourceStamp& stamp);
+	void Close();
+
+	uint64_t GetSourceHash() const { return m_sourceHash; }
+
+	BlockFormat GetFormat() const { return m_format; }
+	int GetComponents() const { return m_components; }
+	const std::vector<Level>& GetLevels() const { return m_levels; }
+
+	// uploads the levels from firstLevel down to 1x1 into the given texture object and makes firstLevel its base
+	// level, GL thread only. BC1/BC3 are expanded to RGBA8 on the CPU when the driver lacks S3TC support.
+	// target may also be one face of a cubemap (GL_TEXTURE_CUBE_MAP_POSITIVE_X + i).
+	bool Upload(unsigned int textureID, unsigned int target = 0x0DE1 /* GL_TEXTURE_2D */, unsigned int firstLevel = 0) const;
+	// adds the level above the current base level of a 2D texture uploaded with Upload and makes it the base
+	bool UploadLevel(unsigned int textureID, unsigned int level) const;
+
+	// bytes the levels from firstLevel down take on the GPU, after any expansion to RGBA8
+	size_t GetUploadSize(unsigned int firstLevel = 0) const;
+
+private:
+	// maps and parses the container, the caller validates the source fields
+	bool open(const std::string& containerPath);
+	unsigned int getInternalFormat() const;
+	bool isExpanded() const;
+	void uploadLevel(unsigned int target, unsigned int level) const;
+
+	AssetFile m_file;
+	BlockFormat m_format = BlockFormat::RGBA8;
+	int m_components = 0;
+	uint64_t m_sourceHash = 0;
+	SourceStamp m_stamp;
+	std::vector<Level> m_levels;
+};
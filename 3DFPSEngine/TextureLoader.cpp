@@ -0,0 +1,90 @@
+#include "TextureLoader.h"
+#include "GLState.h"
+#include "PakArchive.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <iostream>
+
+DecodedImage DecodeImage(const std::string& filename)
+{
+	AssetFile file;
+	if (!file.Open(filename))
+	{
+		DecodedImage image;
+		image.path = filename;
+		return image;
+	}
+	return DecodeImageFromMemory(file.Data(), file.Size(), filename);
+}
+
+DecodedImage DecodeImageFromMemory(const unsigned char* data, size_t size, const std::string& path)
+{
+	DecodedImage image;
+	image.path = path;
+	image.data = stbi_load_from_memory(data, (int)size, &image.width, &image.height, &image.components, 0);
+	return image;
+}
+
+void FreeImage(DecodedImage& image)
+{
+	stbi_image_free(image.data);
+	image.data = nullptr;
+}
+
+bool UploadTexture2D(unsigned int textureID, const DecodedImage& image)
+{
+	if (!image.data)
+	{
+		std::cout << "Texture failed to load at path: " << image.path << std::endl;
+		return false;
+	}
+
+	GLenum format = GL_RGB;
+	if (image.components == 1)
+		format = GL_RED;
+	else if (image.components == 3)
+		format = GL_RGB;
+	else if (image.components == 4)
+		format = GL_RGBA;
+
+	GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return true;
+}
+
+bool UploadCubemap(unsigned int textureID, const std::vector<DecodedImage>& faces)
+{
+	bool complete = true;
+
+	GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	for (unsigned int i = 0; i < faces.size(); i++)
+	{
+		if (faces[i].data)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+				0, GL_RGB, faces[i].width, faces[i].height, 0, GL_RGB, GL_UNSIGNED_BYTE, faces[i].data
+			);
+		}
+		else
+		{
+			std::cout << "Cubemap texture failed to load at path: " << faces[i].path << std::endl;
+			complete = false;
+		}
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	return complete;
+}
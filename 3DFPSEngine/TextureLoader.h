@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Image decoded on the CPU, waiting to be uploaded on the GL thread.
+struct DecodedImage {
+	unsigned char* data = nullptr;
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	std::string path;
+};
+
+// decodes an image file (from the mounted PakArchive if it holds it) with stb_image, safe to call from any thread
+DecodedImage DecodeImage(const std::string& filename);
+
+// decodes an image that is already in memory (path is only kept for error messages), safe to call from any thread
+DecodedImage DecodeImageFromMemory(const unsigned char* data, size_t size, const std::string& path);
+
+void FreeImage(DecodedImage& image);
+
+// uploads a decoded image into the given texture object with mipmaps and repeat wrapping, GL thread only.
+// Returns false (and leaves the texture empty) if the image failed to decode.
+bool UploadTexture2D(unsigned int textureID, const DecodedImage& image);
+
+// uploads six decoded faces (+X, -X, +Y, -Y, +Z, -Z) into the given cubemap texture object, GL thread only.
+bool UploadCubemap(unsigned int textureID, const std::vector<DecodedImage>& faces);
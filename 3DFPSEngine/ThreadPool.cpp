@@ -0,0 +1,97 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threads = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threads; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	// shared with the helper tasks, which may only start after this call has returned
+	struct State
+	{
+		std::atomic<size_t> next;
+		std::atomic<size_t> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::function<void(size_t)> body;
+		size_t count;
+	};
+	auto state = std::make_shared<State>();
+	state->next = 0;
+	state->done = 0;
+	state->body = body;
+	state->count = count;
+
+	auto run = [state]()
+	{
+		size_t i;
+		while ((i = state->next++) < state->count)
+		{
+			state->body(i);
+			if (++state->done == state->count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = count - 1 < m_workers.size() ? count - 1 : m_workers.size();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < helpers; i++)
+			m_tasks.push(run);
+	}
+	m_condition.notify_all();
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done == state->count; });
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
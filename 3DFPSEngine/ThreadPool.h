@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from a shared queue. Used for CPU side asset work (decoding,
+// parsing, baking) so that only the GL calls have to stay on the context thread.
+class ThreadPool
+{
+public:
+	// 0 threads means one worker per hardware thread, leaving one for the main thread
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// queues a task and returns a future for its result
+	template<typename F>
+	std::future<typename std::result_of<F()>::type> Submit(F task)
+	{
+		typedef typename std::result_of<F()>::type Result;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push([packaged]() { (*packaged)(); });
+		}
+		m_condition.notify_one();
+		return result;
+	}
+
+	// runs body(i) for every i in [0, count) on the workers and the calling thread, returns once all calls are done.
+	// Safe to call from inside a task since the caller keeps taking work instead of blocking on the queue.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	unsigned int GetThreadCount() const { return (unsigned int)m_workers.size(); }
+
+	// process wide pool shared by all loaders
+	static ThreadPool& Get();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+};
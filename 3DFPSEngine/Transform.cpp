@@ -1,4 +1,5 @@
 #include "Transform.h"
 
 glm::mat4 Transform::m_projection_matrix;
-glm::mat4 Transform::m_view_matrix;
\ No newline at end of file
+glm::mat4 Transform::m_view_matrix;
+int Transform::m_viewport_height = 0;
\ No newline at end of file
@@ -28,6 +28,7 @@ private:
 
 	static glm::mat4 m_projection_matrix;
 	static glm::mat4 m_view_matrix;
+	static int m_viewport_height;
 
 public:
 
@@ -149,5 +150,15 @@ public:
 	{
 		return m_view_matrix;
 	}
+
+	static void SetViewportHeight(int height)
+	{
+		m_viewport_height = height;
+	}
+
+	static int GetViewportHeight()
+	{
+		return m_viewport_height;
+	}
 };
 
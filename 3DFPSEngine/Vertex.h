@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+struct Vertex {
+	// position
+	glm::vec3 Position;
+	// normal
+	glm::vec3 Normal;
+	// texCoords
+	glm::vec2 TexCoords;
+	// tangent
+	glm::vec3 Tangent;
+	// bitangent
+	glm::vec3 Bitangent;
+};
+
+// Compact 20 byte layout used for baked meshes (see VertexQuantization.h). Positions are 16 bit unorm relative
+// to the mesh bounds, normal and tangent are octahedral encoded and the bitangent is rebuilt from their cross
+// product, its sign is kept in the spare fourth position component. shader.vert decodes it.
+struct PackedVertex {
+	uint16_t Position[4];	// xyz in the mesh bounds, w is 0 or 65535 for a negative or positive bitangent sign
+	int16_t Normal[2];		// octahedral, snorm
+	int16_t Tangent[2];		// octahedral, snorm
+	uint16_t TexCoords[2];	// half floats
+};
+
+enum class VertexFormat : uint32_t {
+	Float = 0,	// Vertex
+	Packed = 1	// PackedVertex
+};
+
+inline size_t GetVertexSize(VertexFormat format)
+{
+	return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+// 16 bit indices whenever every vertex of the mesh can be addressed with them
+inline GLenum ChooseIndexType(size_t numVertices)
+{
+	return numVertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline size_t GetIndexSize(GLenum indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
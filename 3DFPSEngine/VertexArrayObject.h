@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 
+#include "GLState.h"
+
 class VertexArrayObject
 {
 public:
@@ -23,9 +25,9 @@ VertexArrayObject::VertexArrayObject(GLenum mode, unsigned int indices, float* v
 	glGenBuffers(1, &VBO);
 
 	// 1. Bind Vertex Array Object
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 	// 2. Copy vertices array in a vertex buffer for OpenGL to use
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 	// 4. Set the vertex attributes pointers
 	// position attribute
@@ -48,7 +50,7 @@ VertexArrayObject::~VertexArrayObject()
 
 void VertexArrayObject::Bind()
 {
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 }
 
 void VertexArrayObject::Draw()
@@ -0,0 +1,101 @@
+#include "VertexQuantization.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// maps a unit vector onto the [-1, 1] square, folding the lower hemisphere over the diagonals
+static glm::vec2 EncodeOctahedral(glm::vec3 v)
+{
+	float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	if (length < 1e-12f)
+		return glm::vec2(0.0f, 0.0f);
+	v /= length;
+
+	glm::vec2 e(v.x, v.y);
+	if (v.z < 0.0f)
+	{
+		e.x = (1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return e;
+}
+
+static glm::vec3 DecodeOctahedral(glm::vec2 e)
+{
+	glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (v.z < 0.0f)
+	{
+		v.x = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+		v.y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return glm::normalize(v);
+}
+
+static int16_t PackSnorm(float value)
+{
+	return (int16_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+}
+
+static float UnpackSnorm(int16_t value)
+{
+	return std::max(value / 32767.0f, -1.0f);
+}
+
+void QuantizeVertices(const Vertex* vertices, unsigned int numVertices, PackedVertex* out, glm::vec3& boundsMin, glm::vec3& boundsExtent)
+{
+	boundsMin = glm::vec3(0.0f);
+	boundsExtent = glm::vec3(0.0f);
+	if (numVertices == 0)
+		return;
+
+	glm::vec3 boundsMax = vertices[0].Position;
+	boundsMin = vertices[0].Position;
+	for (unsigned int i = 1; i < numVertices; i++)
+	{
+		boundsMin = glm::min(boundsMin, vertices[i].Position);
+		boundsMax = glm::max(boundsMax, vertices[i].Position);
+	}
+	boundsExtent = boundsMax - boundsMin;
+
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		const Vertex& vertex = vertices[i];
+		PackedVertex& packed = out[i];
+
+		for (int c = 0; c < 3; c++)
+		{
+			// flat axes all quantize to 0 and decode to boundsMin
+			float t = boundsExtent[c] > 0.0f ? (vertex.Position[c] - boundsMin[c]) / boundsExtent[c] : 0.0f;
+			packed.Position[c] = (uint16_t)std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f);
+		}
+
+		// only the bitangent's handedness is stored, its direction follows from the normal and tangent
+		float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent);
+		packed.Position[3] = handedness < 0.0f ? 0 : 65535;
+
+		glm::vec2 normal = EncodeOctahedral(vertex.Normal);
+		packed.Normal[0] = PackSnorm(normal.x);
+		packed.Normal[1] = PackSnorm(normal.y);
+
+		glm::vec2 tangent = EncodeOctahedral(vertex.Tangent);
+		packed.Tangent[0] = PackSnorm(tangent.x);
+		packed.Tangent[1] = PackSnorm(tangent.y);
+
+		packed.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+		packed.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+	}
+}
+
+Vertex DequantizeVertex(const PackedVertex& packed, const glm::vec3& boundsMin, const glm::vec3& boundsExtent)
+{
+	Vertex vertex;
+	for (int c = 0; c < 3; c++)
+		vertex.Position[c] = boundsMin[c] + packed.Position[c] / 65535.0f * boundsExtent[c];
+	vertex.Normal = DecodeOctahedral(glm::vec2(UnpackSnorm(packed.Normal[0]), UnpackSnorm(packed.Normal[1])));
+	vertex.Tangent = DecodeOctahedral(glm::vec2(UnpackSnorm(packed.Tangent[0]), UnpackSnorm(packed.Tangent[1])));
+	vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * (packed.Position[3] ? 1.0f : -1.0f);
+	vertex.TexCoords = glm::vec2(glm::unpackHalf1x16(packed.TexCoords[0]), glm::unpackHalf1x16(packed.TexCoords[1]));
+	return vertex;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <glm/glm.hpp>
+
+// Converts float vertices to the 20 byte PackedVertex layout. boundsMin/boundsExtent receive the mesh bounds
+// the positions are quantized against, the shader needs them to decode.
+void QuantizeVertices(const Vertex* vertices, unsigned int numVertices, PackedVertex* out, glm::vec3& boundsMin, glm::vec3& boundsExtent);
+
+// inverse of QuantizeVertices for one vertex, the bitangent comes out as cross(normal, tangent) * sign
+Vertex DequantizeVertex(const PackedVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent);
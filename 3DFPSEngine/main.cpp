@@ -7,16 +7,35 @@
 #include <stb_image.h>
 
 #include "Shader.h"
+#include "GLState.h"
 #include "Camera.h"
 #include "Entity.h"
 #include "GameObject.h"
 #include "MeshRenderer.h"
-
+#include "LightManager.h"
+#include "LightClusters.h"
+#include "DeferredRenderer.h"
+#include "RenderQueue.h"
+#include "AssetStreamer.h"
+#include "HotReload.h"
+#include "TextureCache.h"
+#include "PakArchive.h"
+#include "FileSystem.h"
+#include "Profiler.h"
+#include "MeshReport.h"
+#include "MemoryReport.h"
+#include "LightBenchmark.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
-unsigned int loadCubemap(vector<std::string> faces);
-unsigned int loadTexture(char const* path);
+TextureHandle loadCubemap(vector<std::string> faces);
+TextureHandle loadTexture(char const* path);
 void processInput(Display* display, Camera& camera);
+bool parseCount(const char* text, size_t& value);
 
 // settings
 const unsigned int SCR_WIDTH = 1280;
@@ -26,11 +45,75 @@ const unsigned int SCR_HEIGHT = 720;
 double deltaTime = 0;
 double lastFrame = 0;
 
-int main()
+int main(int argc, char* argv[])
 {
+	// ----- PROFILING -----
+
+	// --profile-startup times the startup phases and asset loads, see the end of the first frames below
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--profile-startup") == 0)
+			Profiler::enabled = true;
+	Profiler::Get();	// event times are relative to this point
+
+	// ----- ASSETS -----
+
+	// --vram-budget <megabytes> caps the GPU memory textures use, the top mip levels of textures that were not
+	// visible recently are dropped to stay within it
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--vram-budget") != 0)
+			continue;
+		size_t megabytes;
+		if (parseCount(argv[i + 1], megabytes) && megabytes > 0 && megabytes < ((size_t)-1 >> 20))
+			TextureCache::vramBudget = megabytes << 20;
+		else
+			std::cout << "ERROR::MAIN::INVALID_VRAM_BUDGET " << argv[i + 1] << std::endl;
+	}
+
+	// --deferred shades the scene with DeferredRenderer instead of the forward lighting shader
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--deferred") == 0)
+			DeferredRenderer::enabled = true;
+
+	// --crates <count> adds a grid of crates sharing one model, which RenderQueue draws instanced
+	size_t crateCount = 0;
+	for (int i = 1; i + 1 < argc; i++)
+		if (strcmp(argv[i], "--crates") == 0 && !parseCount(argv[i + 1], crateCount))
+			std::cout << "ERROR::MAIN::INVALID_CRATE_COUNT " << argv[i + 1] << std::endl;
+
+	// --gl-stats prints how many state changes GLState passed on and skipped and what RenderQueue drew, every 300 frames
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--gl-stats") == 0)
+		{
+			GLState::reportInterval = 300;
+			RenderQueue::reportInterval = 300;
+		}
+
+	// a packed archive (asset-cook --pak) replaces the loose files, every path it holds is read from it
+	int64_t pakTime;
+	if (GetModificationTime(PakArchive::DEFAULT_PATH, pakTime))
+	{
+		ProfileScope scope("phase", "mount pak");
+		if (!PakArchive::Get().Mount(PakArchive::DEFAULT_PATH))
+			std::cout << "ERROR::PAK_ARCHIVE::COULD_NOT_MOUNT " << PakArchive::DEFAULT_PATH << std::endl;
+	}
+
+	// ----- TOOLS -----
+
+	if (argc > 1 && strcmp(argv[1], "--mesh-report") == 0)
+		return RunMeshReport(argc > 2 ? argv[2] : "./res");
+	if (argc > 1 && strcmp(argv[1], "--bench-lights") == 0)
+		return RunLightBenchmark();
+
 	// ----- WINDOW -----
 
+	Profiler::Clock::time_point phaseStart = Profiler::Clock::now();
 	Display display(SCR_WIDTH, SCR_HEIGHT, "3DFPSEngine");
+	Profiler::Get().Record("phase", "Display", phaseStart, Profiler::Clock::now());
+
+	// the memory report uploads models, so it needs the GL context
+	if (argc > 1 && strcmp(argv[1], "--memory-report") == 0)
+		return RunMemoryReport(argc > 2 ? argv[2] : "./res");
 
 	// ----- SCENE GRAPH -----
 
@@ -42,23 +125,62 @@ int main()
 
 	// ----- OPENGL STATES -----
 
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_MULTISAMPLE); // MSAA
+	GLState::Get().Enable(GL_DEPTH_TEST);
+	GLState::Get().Enable(GL_MULTISAMPLE); // MSAA
 
 	// ----- SHADER COMPILATION -----
 
+	// every shader reads the camera matrices from the one buffer CameraUniforms fills per frame
+	Shader::SetBlockBinding(CameraUniforms::BLOCK_NAME, CameraUniforms::BINDING);
+	// and the lit ones their lights from the buffer LightManager fills
+	Shader::SetBlockBinding(LightManager::BLOCK_NAME, LightManager::BINDING);
+	Shader::SetBlockBinding(LightClusters::BLOCK_NAME, LightClusters::BINDING);
 	Shader lightingShader("./shaders/shader.vert", "./shaders/shader.frag");
 	Shader lampShader("./shaders/lampshader.vert", "./shaders/lampshader.frag");
 	Shader skyboxShader("./shaders/skyboxshader.vert", "./shaders/skyboxshader.frag");
 
 	// ----- SHADER CONFIG -----
 
+	auto configLighting = [](Shader& shader)
+	{
+		shader.setInt("material.diffuse", 0);
+		shader.setInt("material.specular", 1);
+		shader.setFloat("material.shininess", 32.0f);
+		shader.setInt("lightData", LightManager::TEXTURE_UNIT);
+		shader.setInt("clusterData", LightClusters::CLUSTER_TEXTURE_UNIT);
+		shader.setInt("clusterLights", LightClusters::INDEX_TEXTURE_UNIT);
+	};
+	auto configSkybox = [](Shader& shader)
+	{
+		shader.setInt("skybox", 0);
+	};
+
 	lightingShader.use();
-	lightingShader.setInt("material.diffuse", 0);
-	lightingShader.setInt("material.specular", 1);
+	configLighting(lightingShader);
 
 	skyboxShader.use();
-	skyboxShader.setInt("skybox", 0);
+	configSkybox(skyboxShader);
+
+	// the scene is drawn with the lighting shader, or into the G-buffer with deferred shading
+	unique_ptr<DeferredRenderer> deferred;
+	if (DeferredRenderer::enabled)
+		deferred.reset(new DeferredRenderer());
+	Shader& sceneShader = deferred ? deferred->GetGeometryShader() : lightingShader;
+
+	// ----- HOT RELOAD -----
+
+	// edits to shaders, textures and models show up without a restart. Cooked builds and a mounted pak don't
+	// read the loose sources.
+	if (!CookManifest::cookedOnly && !PakArchive::Get().IsMounted())
+	{
+		HotReload::Get().WatchDirectory("./shaders");
+		HotReload::Get().WatchDirectory("./res");
+		HotReload::Get().WatchShader(lightingShader, configLighting);
+		HotReload::Get().WatchShader(lampShader);
+		HotReload::Get().WatchShader(skyboxShader, configSkybox);
+		if (deferred)
+			deferred->WatchShaders();
+	}
 
 	// ----- SKYBOX -----
 
@@ -110,8 +232,8 @@ int main()
 	unsigned int skyboxVAO, skyboxVBO;
 	glGenVertexArrays(1, &skyboxVAO);
 	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+	GLState::Get().BindVertexArray(skyboxVAO);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -125,12 +247,13 @@ int main()
 		"./res/skybox/front.tga",
 		"./res/skybox/back.tga"
 	};
-	unsigned int cubemapTexture = loadCubemap(faces_cube);
+	TextureHandle cubemapTexture = loadCubemap(faces_cube);
 
 	// ----- CUSTOM MODELS -----
 
+	// Models stream in over the first frames instead of blocking startup
 	// Nanosuit
-	MeshRenderer nanosuit("./res/nanosuit/nanosuit.obj", lightingShader);
+	MeshRenderer nanosuit(AssetStreamer::Get().LoadModelAsync("./res/nanosuit/nanosuit.obj"), sceneShader);
 	GameObject nanosuitObject;
 	root.AddChild(nanosuitObject);
 	nanosuitObject.AddComponent(nanosuit);
@@ -138,30 +261,74 @@ int main()
 	nanosuitObject.GetTransform().SetScale(glm::vec3(0.2f, 0.2f, 0.2f));
 
 	// Wooden Crate
-	MeshRenderer box("./res/box/Wooden Crate.obj", lightingShader);
+	MeshRenderer box(AssetStreamer::Get().LoadModelAsync("./res/box/Wooden Crate.obj"), sceneShader);
 	GameObject boxObject;
 	root.AddChild(boxObject);
 	boxObject.AddComponent(box);
 	boxObject.GetTransform().SetPos(glm::vec3(0.0f, -1.75f, -1.75f));
 	boxObject.GetTransform().SetScale(glm::vec3(0.25f, 0.25f, 0.25f));
 
-	// Point Lights
+	// the grid behind it loads the same file, so every crate shares the model above. GameObject keeps pointers to
+	// its children and components, so neither array may reallocate.
+	unique_ptr<GameObject[]> crateObjects(new GameObject[crateCount]);
+	vector<unique_ptr<MeshRenderer>> crates;
+	int crateColumns = (int)std::ceil(std::sqrt((double)crateCount));
+	for (size_t i = 0; i < crateCount; i++)
+	{
+		crates.emplace_back(new MeshRenderer(AssetStreamer::Get().LoadModelAsync("./res/box/Wooden Crate.obj"), sceneShader));
+		crateObjects[i].AddComponent(*crates.back());
+		int column = (int)i % crateColumns, row = (int)i / crateColumns;
+		crateObjects[i].GetTransform().SetPos(glm::vec3((column - crateColumns / 2) * 0.75f, -1.75f, -3.0f - row * 0.75f));
+		crateObjects[i].GetTransform().SetScale(glm::vec3(0.25f, 0.25f, 0.25f));
+		root.AddChild(crateObjects[i]);
+	}
+
+	// ----- LIGHTS -----
+
+	// the lights go into the light buffer by themselves, LightManager uploads whichever changed once per frame
+	Light sun(LightType::Directional);
+	sun.SetDirection(glm::vec3(-0.2f, -1.0f, -0.3f));
+	sun.SetColors(glm::vec3(0.05f), glm::vec3(0.4f), glm::vec3(0.5f));
+
+	// flashlight, follows the camera
+	Light flashlight(LightType::Spot);
+	flashlight.SetColors(glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f));
+	flashlight.SetAttenuation(1.0f, 0.09f, 0.032f);
+	flashlight.SetCone(12.5f, 15.0f);
+
+	// point lights, placed by their game objects
 	glm::vec3 pointLightPositions[] = {
 		glm::vec3(0.7f,  0.2f,  2.0f),
 		glm::vec3(2.3f, -3.3f, -4.0f),
 		glm::vec3(-4.0f,  2.0f, -12.0f),
 		glm::vec3(0.0f,  0.0f, -3.0f)
 	};
+	Light pointLights[4];
+	GameObject pointLightObjects[4];
+	for (int i = 0; i < 4; i++)
+	{
+		pointLights[i].SetColors(glm::vec3(0.05f), glm::vec3(0.8f), glm::vec3(1.0f));
+		pointLights[i].SetAttenuation(1.0f, 0.09f, 0.032f);
+		pointLightObjects[i].AddComponent(pointLights[i]);
+		pointLightObjects[i].GetTransform().SetPos(pointLightPositions[i]);
+		root.AddChild(pointLightObjects[i]);
+	}
 
 	// ----- RENDER LOOP -----
 	
 	while (!display.ShouldClose())
 	{
+		ProfileScope frameScope("frame", "frame");
+
 		// Timing
 		double currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		// Pick up edited assets, then upload whatever finished loading since the last frame, within the per frame budget
+		HotReload::Get().Update();
+		AssetStreamer::Get().Update();
+
 		// Input
 		processInput(&display, camera);
 		root.Input();
@@ -169,88 +336,22 @@ int main()
 		// Clear previous buffer
 		display.Clear();
 
+		// Copy projection and view matrix to the transforms and the camera uniform buffer, before anything is drawn
+		camera.CopyVectors();
+
 		// ----- DRAW SKYBOX -----
 
 		skyboxShader.use();
-		glDepthMask(GL_FALSE);
-		glm::mat4 view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // remove translation from the view matrix
-		skyboxShader.setMat4("view", view);
-		skyboxShader.setMat4("projection", camera.GetProjectionMatrix());
-		glBindVertexArray(skyboxVAO);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+		GLState::Get().DepthMask(GL_FALSE);
+		GLState::Get().BindVertexArray(skyboxVAO);
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_CUBE_MAP, cubemapTexture->GetID());
 		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glDepthMask(GL_TRUE);
-
-		// ----- DRAW LIGHTS -----
-
-		lightingShader.use();
-		lightingShader.setFloat("material.shininess", 32.0f);
-		lightingShader.setVec3("viewPos", camera.Position);
-
-		/*
-		Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-		the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-		by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-		by using 'Uniform buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-		*/
-
-		/*
-		Regarding dynamic number of lights in fragment shader (using defined static upper bound)...
-		You usually define an upper bound(let's call this n) and update the array accordingly, taking the n closest lights
-		at any time and using those n lights to fill the light array. If a light gets too far, it isn't considered anymore for lighting
-		in this arrayand replaced with a more closer light. A more flexible approach would be to use deferred rendering with
-		rendering a light volume for each (close enough) light in your scene.With that approach the fragment shader doesn't need
-		to know about the numer of lights, you simply issue a draw call for each light you want to contribute.
-		*/
-
-		// directional light
-		lightingShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-		lightingShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-		lightingShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-		// point light 1
-		lightingShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-		lightingShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[0].constant", 1.0f);
-		lightingShader.setFloat("pointLights[0].linear", 0.09f);
-		lightingShader.setFloat("pointLights[0].quadratic", 0.032f);
-		// point light 2
-		lightingShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-		lightingShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[1].constant", 1.0f);
-		lightingShader.setFloat("pointLights[1].linear", 0.09f);
-		lightingShader.setFloat("pointLights[1].quadratic", 0.032f);
-		// point light 3
-		lightingShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-		lightingShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[2].constant", 1.0f);
-		lightingShader.setFloat("pointLights[2].linear", 0.09f);
-		lightingShader.setFloat("pointLights[2].quadratic", 0.032f);
-		// point light 4
-		lightingShader.setVec3("pointLights[3].position", pointLightPositions[3]);
-		lightingShader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[3].constant", 1.0f);
-		lightingShader.setFloat("pointLights[3].linear", 0.09f);
-		lightingShader.setFloat("pointLights[3].quadratic", 0.032f);
-		// spotLight
-		lightingShader.setVec3("spotLight.position", camera.Position);
-		lightingShader.setVec3("spotLight.direction", camera.Front);
-		lightingShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-		lightingShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-		lightingShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("spotLight.constant", 1.0f);
-		lightingShader.setFloat("spotLight.linear", 0.09f);
-		lightingShader.setFloat("spotLight.quadratic", 0.032f);
-		lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-		lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+		GLState::Get().DepthMask(GL_TRUE);
+
+		// ----- LIGHTS -----
+
+		flashlight.SetPosition(camera.Position);
+		flashlight.SetDirection(camera.Front);
 
 		// ----- DRAW LAMPS -----
 
@@ -258,12 +359,29 @@ int main()
 
 		// ----- RENDER SCENE GRAPH -----
 
-		camera.CopyVectors(); // Copy projection and view matrix to transform object
 		root.Update();
-		root.Render();
+		LightManager::Get().Update();	// after the scene update moved the lights
+		if (deferred)
+		{
+			deferred->BeginGeometry(display.GetWidth(), display.GetHeight());
+			root.Render();
+			RenderQueue::Get().Submit();
+			deferred->Shade();
+		}
+		else
+		{
+			LightClusters::Get().Update(camera.GetProjectionMatrix(), camera.GetViewMatrix(), display.GetWidth(), display.GetHeight());
+			root.Render();	// queues the draws
+			RenderQueue::Get().Submit();
+		}
 
 		// Swap buffers
 		display.Update();
+		GLState::Get().EndFrame();
+
+		// startup is over once everything requested so far is on the GPU
+		if (Profiler::Get().IsRecording() && AssetStreamer::Get().GetPendingCount() == 0 && TextureCache::Get().GetPendingCount() == 0)
+			Profiler::Get().Finish("./startup_trace.json", "./startup_summary.txt");
 	}
 
 	// ----- RESOURCE DEALLOCATION -----
@@ -293,74 +411,36 @@ void processInput(Display* display, Camera& camera)
 }
 
 // Cubemap loader
-unsigned int loadCubemap(vector<std::string> faces)
+TextureHandle loadCubemap(vector<std::string> faces)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	// the six faces are decoded at once on the thread pool, only the upload happens here
+	TextureHandle texture = TextureCache::Get().AcquireCubemap(faces);
+	TextureCache::Get().FinishLoads(vector<TextureHandle>(1, texture));
 
-	int width, height, nrChannels;
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
-		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-			);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	return textureID;
+	return texture;
 }
 
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
-unsigned int loadTexture(char const* path)
+TextureHandle loadTexture(char const* path)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	TextureHandle texture = TextureCache::Get().Acquire(path);
+	TextureCache::Get().FinishLoads(vector<TextureHandle>(1, texture));
 
-	int width, height, nrComponents;
-	GLenum format = NULL;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
+	return texture;
 }
 
+// reads a whole decimal argument, false if it is empty, has anything after the digits or doesn't fit
+// ---------------------------------------------------------------------------------------------------
+bool parseCount(const char* text, size_t& value)
+{
+	if (*text < '0' || *text > '9')
+		return false;
+	errno = 0;
+	char* end;
+	unsigned long long parsed = strtoull(text, &end, 10);
+	if (*end != '\0' || errno == ERANGE || parsed > (size_t)-1)
+		return false;
+	value = (size_t)parsed;
+	return true;
+}
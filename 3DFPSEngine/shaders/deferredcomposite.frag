@@ -0,0 +1,31 @@
+#version 330 core
+// copies the lit scene of DeferredRenderer to the screen, with its depth
+out vec4 FragColor;
+
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+uniform sampler2D gDepth;
+uniform sampler2D lightBuffer;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // nothing drawn here, the sky stays
+    if (depth == 0.0)
+        discard;
+
+    FragColor = vec4(texelFetch(lightBuffer, pixel, 0).rgb, 1.0);
+    vec4 clip = projection * vec4(0.0, 0.0, -depth, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+// full screen triangle, already in clip space
+layout (location = 0) in vec3 aPos;
+
+void main()
+{
+    gl_Position = vec4(aPos.xy, 0.0, 1.0);
+}
@@ -0,0 +1,132 @@
+#version 330 core
+// light pass of DeferredRenderer: adds one light's contribution to the pixels of its volume
+out vec4 FragColor;
+
+struct Material {
+    float shininess;
+};
+
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+uniform samplerBuffer lightData;
+
+#define LIGHT_TEXELS 6
+#define LIGHT_DIRECTIONAL 0
+#define LIGHT_POINT 1
+#define LIGHT_SPOT 2
+
+struct Light {
+    int type;
+    vec3 position;
+    vec3 direction;
+    float range;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    float cutOff;
+    float outerCutOff;
+};
+
+flat in int LightIndex;
+
+uniform Material material;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+// function prototypes
+Light FetchLight(int index);
+vec3 CalcLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 norm = normalize(texelFetch(gNormal, pixel, 0).xyz * 2.0 - 1.0);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+
+    // back along the pixel's view ray to the stored depth
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 nearPoint = inverseProjection * vec4(ndc, -1.0, 1.0);
+    vec3 viewPos = nearPoint.xyz / nearPoint.w;
+    viewPos *= depth / -viewPos.z;
+    vec3 fragPos = vec3(inverseView * vec4(viewPos, 1.0));
+
+    vec3 viewDir = normalize(cameraPosition.xyz - fragPos);
+    vec3 result = CalcLight(FetchLight(LightIndex), norm, fragPos, viewDir, albedoSpec.rgb, vec3(albedoSpec.a));
+    FragColor = vec4(result, 1.0);
+}
+
+Light FetchLight(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 t0 = texelFetch(lightData, base);
+    vec4 t1 = texelFetch(lightData, base + 1);
+    vec4 t2 = texelFetch(lightData, base + 2);
+    vec4 t3 = texelFetch(lightData, base + 3);
+    vec4 t4 = texelFetch(lightData, base + 4);
+    vec4 t5 = texelFetch(lightData, base + 5);
+
+    Light light;
+    light.position = t0.xyz;
+    light.type = int(t0.w);
+    light.direction = t1.xyz;
+    light.range = t1.w;
+    light.ambient = t2.rgb;
+    light.constant = t2.w;
+    light.diffuse = t3.rgb;
+    light.linear = t3.w;
+    light.specular = t4.rgb;
+    light.quadratic = t4.w;
+    light.cutOff = t5.x;
+    light.outerCutOff = t5.y;
+    return light;
+}
+
+// calculates the color contributed by one light
+vec3 CalcLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float attenuation = 1.0;
+    if (light.type != LIGHT_DIRECTIONAL)
+    {
+        float distance = length(light.position - fragPos);
+        if (distance > light.range)
+            return vec3(0.0);
+        lightDir = (light.position - fragPos) / distance;
+        attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+        // spotlight intensity
+        if (light.type == LIGHT_SPOT)
+        {
+            float theta = dot(lightDir, normalize(-light.direction)); 
+            float epsilon = light.cutOff - light.outerCutOff;
+            attenuation *= clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+        }
+    }
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+    return (ambient + diffuse + specular) * attenuation;
+}
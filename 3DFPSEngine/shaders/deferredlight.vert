@@ -0,0 +1,50 @@
+#version 330 core
+// light pass of DeferredRenderer: one instance per light, placed around the light's range
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in int aLight;    // the light's slot in lightData
+
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+uniform samplerBuffer lightData;
+uniform int volume;     // 0: full screen triangle in clip space, 1: unit sphere, 2: unit cone along +z
+
+#define LIGHT_TEXELS 6
+
+flat out int LightIndex;
+
+void main()
+{
+    LightIndex = aLight;
+    if (volume == 0)
+    {
+        gl_Position = vec4(aPos.xy, 0.0, 1.0);
+        return;
+    }
+
+    vec4 positionType = texelFetch(lightData, aLight * LIGHT_TEXELS);
+    vec4 directionRange = texelFetch(lightData, aLight * LIGHT_TEXELS + 1);
+    float range = directionRange.w;
+    vec3 world = positionType.xyz + aPos * range;
+    if (volume == 2)
+    {
+        // the cone reaches range along the axis and as wide as the outer cutoff there
+        float cosOuter = texelFetch(lightData, aLight * LIGHT_TEXELS + 5).y;
+        float radius = range * sqrt(1.0 - cosOuter * cosOuter) / cosOuter;
+        vec3 axis = normalize(directionRange.xyz);
+        vec3 side = normalize(cross(axis, abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+        // side x up = axis keeps the basis right handed, so the cone keeps the winding it was built with
+        vec3 up = cross(axis, side);
+        world = positionType.xyz + (side * aPos.x + up * aPos.y) * radius + axis * (aPos.z * range);
+    }
+    gl_Position = viewProjection * vec4(world, 1.0);
+}
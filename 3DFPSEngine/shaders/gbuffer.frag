@@ -0,0 +1,35 @@
+#version 330 core
+// geometry pass of DeferredRenderer: the surface properties the light pass needs, no lighting
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out float gDepth;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+};
+
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main()
+{
+    gAlbedoSpec = vec4(texture(material.diffuse, TexCoords).rgb, texture(material.specular, TexCoords).r);
+    gNormal = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+    gDepth = -(view * vec4(FragPos, 1.0)).z;
+}
@@ -7,141 +7,156 @@ struct Material {
     float shininess;
 }; 
 
-struct DirLight {
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+// every enabled light, packed by LightManager into lightData, LIGHT_TEXELS texels per light
+layout (std140) uniform Lights {
+    ivec4 lightCount;   // x
+};
+uniform samplerBuffer lightData;
+
+// the lights reaching each cluster of the view, binned by LightClusters. clusterLights holds the global lights
+// first, clusterData the offset and count of every cluster's list in it.
+layout (std140) uniform Clusters {
+    ivec4 clusterGrid;  // xyz: clusters along each axis, 0 when clustering is off; w: global lights
+    vec4 clusterDepth;  // slice = int(log(view depth) * x + y)
+    vec4 clusterTile;   // xy: tile size in pixels
+};
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer clusterLights;
+
+#define LIGHT_TEXELS 6
+#define LIGHT_DIRECTIONAL 0
+#define LIGHT_POINT 1
+#define LIGHT_SPOT 2
+
+struct Light {
+    int type;
+    vec3 position;
     vec3 direction;
-	
+    float range;
+
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-};
 
-struct PointLight {
-    vec3 position;
-    
     float constant;
     float linear;
     float quadratic;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
     float cutOff;
     float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
 };
 
-#define NR_POINT_LIGHTS 4
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
 uniform Material material;
 
 // function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+Light FetchLight(int index);
+vec3 CalcLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
 
 void main()
 {    
     // properties
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(cameraPosition.xyz - FragPos);
+    vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords));
+    vec3 specularColor = vec3(texture(material.specular, TexCoords));
     
     // == =====================================================
-    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-    // For each phase, a calculate function is defined that calculates the corresponding color
-    // per lamp. In the main() function we take all the calculated colors and sum them up for
-    // this fragment's final color.
+    // Every light, directional, point or spot, is one record in the light buffer. Each adds its
+    // contribution to this fragment's final color; lights farther away than their range add nothing.
+    // With clustering on only the lights binned into this fragment's cluster are visited.
     // == =====================================================
-    // phase 1: directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
-    // phase 2: point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
-    // phase 3: spot light
-    result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
+    vec3 result = vec3(0.0);
+    if (clusterGrid.x == 0)
+    {
+        for (int i = 0; i < lightCount.x; i++)
+            result += CalcLight(FetchLight(i), norm, FragPos, viewDir, diffuseColor, specularColor);
+    }
+    else
+    {
+        for (int i = 0; i < clusterGrid.w; i++)
+            result += CalcLight(FetchLight(int(texelFetch(clusterLights, i).r)), norm, FragPos, viewDir, diffuseColor, specularColor);
+
+        float depth = -(view * vec4(FragPos, 1.0)).z;
+        ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTile.xy), int(log(depth) * clusterDepth.x + clusterDepth.y));
+        cluster = clamp(cluster, ivec3(0), clusterGrid.xyz - 1);
+        uvec2 list = texelFetch(clusterData, (cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x).rg;
+        for (uint i = 0u; i < list.y; i++)
+            result += CalcLight(FetchLight(int(texelFetch(clusterLights, int(list.x + i)).r)), norm, FragPos, viewDir, diffuseColor, specularColor);
+    }
     
     FragColor = vec4(result, 1.0);
 }
 
-// calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+Light FetchLight(int index)
 {
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    return (ambient + diffuse + specular);
-}
+    int base = index * LIGHT_TEXELS;
+    vec4 t0 = texelFetch(lightData, base);
+    vec4 t1 = texelFetch(lightData, base + 1);
+    vec4 t2 = texelFetch(lightData, base + 2);
+    vec4 t3 = texelFetch(lightData, base + 3);
+    vec4 t4 = texelFetch(lightData, base + 4);
+    vec4 t5 = texelFetch(lightData, base + 5);
 
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
+    Light light;
+    light.position = t0.xyz;
+    light.type = int(t0.w);
+    light.direction = t1.xyz;
+    light.range = t1.w;
+    light.ambient = t2.rgb;
+    light.constant = t2.w;
+    light.diffuse = t3.rgb;
+    light.linear = t3.w;
+    light.specular = t4.rgb;
+    light.quadratic = t4.w;
+    light.cutOff = t5.x;
+    light.outerCutOff = t5.y;
+    return light;
 }
 
-// calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+// calculates the color contributed by one light
+vec3 CalcLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(-light.direction);
+    float attenuation = 1.0;
+    if (light.type != LIGHT_DIRECTIONAL)
+    {
+        float distance = length(light.position - fragPos);
+        if (distance > light.range)
+            return vec3(0.0);
+        lightDir = (light.position - fragPos) / distance;
+        attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+        // spotlight intensity
+        if (light.type == LIGHT_SPOT)
+        {
+            float theta = dot(lightDir, normalize(-light.direction)); 
+            float epsilon = light.cutOff - light.outerCutOff;
+            attenuation *= clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+        }
+    }
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction)); 
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+    return (ambient + diffuse + specular) * attenuation;
+}
@@ -1,22 +1,57 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance model matrix, used instead of the model uniform when instanced is set (RenderQueue batches)
+layout (location = 5) in mat4 aInstanceModel;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+// filled once per frame by CameraUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
+
+// set for meshes in the packed vertex layout: positions are unorm within the mesh bounds and the normal is
+// octahedral encoded in aNormal.xy
+uniform bool quantized;
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    vec3 position = aPos.xyz;
+    vec3 normal = aNormal;
+    if (quantized)
+    {
+        position = boundsMin + aPos.xyz * boundsExtent;
+        normal = DecodeOctahedral(aNormal.xy);
+    }
+
+    mat4 world = instanced ? aInstanceModel : model;
+    FragPos = vec3(world * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(world))) * normal;  
     TexCoords = aTexCoords;
     
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
-
@@ -0,0 +1,300 @@
+// asset-cook: converts the models and textures below a source directory into the formats the engine loads at
+// runtime (MeshCache and TextureContainer files) and writes the CookManifest that release builds load them by.
+//
+// usage: asset-cook [source directory = ./res] [output directory = ./cooked] [--pak <archive>]
+//
+// --pak also packs the cooked outputs, the manifest, the sources and ./shaders into one PakArchive, which the engine
+// mounts instead of reading loose files when it finds it (as ./assets.pak).
+// Run it from the engine directory so the recorded source paths match the ones the engine asks for.
+// Every output is named by the hash of its inputs, so only outputs whose inputs changed are rebuilt.
+// Dependencies: a model's output covers the model file, the material libraries it references (.obj -> .mtl, part
+// of Model::ComputeSourceHash) and the import settings. The textures the materials name (.mtl -> textures) are cooked as outputs of their own,
+// discovered from the cooked model, so a changed texture only rebuilds that texture.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "CookManifest.h"
+#include "FileSystem.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "PakArchive.h"
+#include "TextureContainer.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+using namespace std;
+
+enum class AssetKind { Model, Texture };
+
+struct CookNode {
+	AssetKind kind;
+	string source;
+	vector<string> dependencies;	// files other than the source that the output is built from
+	uint64_t key = 0;				// hash of the source, the dependencies and the settings
+	string output;					// file name in the output directory
+	bool cooked = false;			// rebuilt by this run
+	bool failed = false;
+};
+
+static bool IsImage(const string& extension)
+{
+	static const char* const IMAGE_EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm" };
+	for (const char* image : IMAGE_EXTENSIONS)
+		if (extension == image)
+			return true;
+	return false;
+}
+
+static uint64_t HashFile(const string& path, uint64_t hash)
+{
+	MappedFile file;
+	if (file.Open(path))
+		hash = HashBytes(file.Data(), file.Size(), hash);
+	else
+		hash = HashBytes("missing", 7, hash);
+	return hash;
+}
+
+static void ComputeKey(CookNode& node)
+{
+	uint64_t key;
+	if (node.kind == AssetKind::Model)
+	{
+		key = Model::ComputeSourceHash(node.source);
+
+		uint32_t settings[3] = { Model::IMPORT_FLAGS, (uint32_t)Model::GetVertexFormat(), MeshCache::VERSION };
+		key = HashBytes(settings, sizeof(settings), key);
+		node.output = CookManifest::GetOutputName(key, ".meshcache");
+	}
+	else
+	{
+		key = HashFile(node.source, HASH_SEED);
+		uint32_t version = TextureContainer::VERSION;
+		key = HashBytes(&version, sizeof(version), key);
+		node.output = CookManifest::GetOutputName(key, ".texcache");
+	}
+	node.key = key;
+}
+
+// whether an output with the node's key already exists and is intact
+static bool IsUpToDate(const CookNode& node, const string& outputDirectory)
+{
+	string path = outputDirectory + "/" + node.output;
+	if (node.kind == AssetKind::Model)
+	{
+		MeshCache cache;
+		return cache.Open(path, node.key, Model::IMPORT_FLAGS, Model::GetVertexFormat());
+	}
+	TextureContainer container;
+	return container.Open(path, node.key);
+}
+
+static bool Cook(const CookNode& node, const string& outputDirectory)
+{
+	string path = outputDirectory + "/" + node.output;
+	if (node.kind == AssetKind::Model)
+	{
+		ModelData data;
+		data.directory = node.source.substr(0, node.source.find_last_of('/'));
+		data.acquireTextures = false;
+		if (!Model::ImportData(node.source, data))
+			return false;
+		return MeshCache::Write(path, node.key, Model::IMPORT_FLAGS, Model::GetVertexFormat(), data.meshes);
+	}
+
+	MappedFile file;
+	if (!file.Open(node.source))
+		return false;
+	DecodedImage image = DecodeImageFromMemory(file.Data(), file.Size(), node.source);
+	if (!image.data)
+		return false;
+	bool baked = TextureContainer::Bake(path, node.key, image.data, image.width, image.height, image.components,
+		TextureContainer::ChooseFormat(image.components));
+	FreeImage(image);
+	return baked;
+}
+
+// hashes the nodes and rebuilds the stale ones, spread over the thread pool
+static void CookAll(vector<CookNode*>& nodes, const string& outputDirectory)
+{
+	vector<future<void>> keys;
+	for (CookNode* node : nodes)
+		keys.push_back(ThreadPool::Get().Submit([node]() { ComputeKey(*node); }));
+	for (auto& key : keys)
+		key.get();
+
+	vector<future<bool>> results;
+	vector<CookNode*> stale;
+	for (CookNode* node : nodes)
+	{
+		if (IsUpToDate(*node, outputDirectory))
+			continue;
+		stale.push_back(node);
+		results.push_back(ThreadPool::Get().Submit([node, outputDirectory]() { return Cook(*node, outputDirectory); }));
+	}
+
+	for (size_t i = 0; i < stale.size(); i++)
+	{
+		stale[i]->cooked = results[i].get();
+		stale[i]->failed = !stale[i]->cooked;
+		printf("%s %s\n", stale[i]->failed ? "FAILED" : "cooked", stale[i]->source.c_str());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	vector<string> positional;
+	string pakPath;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--pak") == 0 && i + 1 < argc)
+			pakPath = argv[++i];
+		else
+			positional.push_back(argv[i]);
+	}
+	string sourceDirectory = positional.size() > 0 ? positional[0] : "./res";
+	string outputDirectory = positional.size() > 1 ? positional[1] : CookManifest::DIRECTORY;
+	if (!MakeDirectory(outputDirectory))
+	{
+		printf("ERROR::ASSET_COOK::COULD_NOT_CREATE %s\n", outputDirectory.c_str());
+		return 1;
+	}
+
+	// ----- DEPENDENCY GRAPH -----
+
+	Assimp::Importer importer;
+	vector<unique_ptr<CookNode>> graph;
+	unordered_map<string, CookNode*> byPath;	// canonical source path -> node
+
+	auto addNode = [&](AssetKind kind, const string& path) -> CookNode*
+	{
+		string key = CanonicalPath(path);
+		if (byPath.count(key))
+			return nullptr;
+		unique_ptr<CookNode> node(new CookNode());
+		node->kind = kind;
+		node->source = path;
+		byPath[key] = node.get();
+		graph.push_back(std::move(node));
+		return graph.back().get();
+	};
+
+	vector<CookNode*> pass;
+	for (const string& path : ListFiles(sourceDirectory))
+	{
+		string extension = GetExtension(path);
+		CookNode* node = nullptr;
+		if (IsImage(extension))
+			node = addNode(AssetKind::Texture, path);
+		else if (!extension.empty() && importer.IsExtensionSupported(extension.c_str()))
+		{
+			node = addNode(AssetKind::Model, path);
+			if (node)
+			{
+				AssetFile source;
+				source.Open(path);
+				node->dependencies = Model::GetMaterialLibraries(path, source);
+			}
+		}
+		if (node)
+			pass.push_back(node);
+	}
+
+	// ----- COOK -----
+
+	// first the models and every image found, then the textures the models name that live elsewhere
+	CookAll(pass, outputDirectory);
+
+	pass.clear();
+	for (size_t i = 0; i < graph.size(); i++)
+	{
+		CookNode& node = *graph[i];
+		if (node.kind != AssetKind::Model || node.failed)
+			continue;
+
+		MeshCache cache;
+		if (!cache.Open(outputDirectory + "/" + node.output, node.key, Model::IMPORT_FLAGS, Model::GetVertexFormat()))
+			continue;
+		string directory = node.source.substr(0, node.source.find_last_of('/'));
+		for (const MeshData& mesh : cache.GetMeshes())
+			for (const Texture& texture : mesh.textures)
+				if (CookNode* referenced = addNode(AssetKind::Texture, directory + "/" + texture.path))
+					pass.push_back(referenced);
+	}
+	CookAll(pass, outputDirectory);
+
+	// ----- MANIFEST -----
+
+	CookManifest manifest;
+	size_t cooked = 0, upToDate = 0, failed = 0;
+	for (const auto& node : graph)
+	{
+		if (node->failed)
+		{
+			failed++;
+			continue;
+		}
+		node->cooked ? cooked++ : upToDate++;
+		manifest.Add(node->source, node->output, node->key);
+	}
+	if (!manifest.Save(outputDirectory))
+		return 1;
+
+	// outputs nothing refers to any more are superseded versions of an asset
+	size_t removed = 0;
+	for (const string& path : ListFiles(outputDirectory))
+	{
+		string extension = GetExtension(path);
+		string name = path.substr(path.find_last_of('/') + 1);
+		if ((extension == ".meshcache" || extension == ".texcache") && !manifest.Contains(name))
+			removed += std::remove(path.c_str()) == 0;
+	}
+
+	printf("%zu cooked, %zu up to date, %zu failed, %zu stale outputs removed\n", cooked, upToDate, failed, removed);
+
+	// ----- PAK -----
+
+	if (!pakPath.empty())
+	{
+		// the baked formats are used in place from the mapping, so they are stored as is. Images are compressed
+		// already, everything else (model sources, shaders, the manifest) is read once and worth compressing.
+		vector<PakArchive::Input> inputs;
+		unordered_set<string> packed;	// identical assets share an output, models can share material libraries
+		auto pack = [&](const string& path, bool compress)
+		{
+			if (packed.insert(CanonicalPath(path)).second)
+				inputs.push_back({ path, path, compress });
+		};
+
+		pack(outputDirectory + "/" + CookManifest::FILE_NAME, true);
+		for (const auto& node : graph)
+		{
+			if (node->failed)
+				continue;
+			pack(outputDirectory + "/" + node->output, false);
+			pack(node->source, node->kind == AssetKind::Model);
+			for (const string& dependency : node->dependencies)
+				pack(dependency, true);
+		}
+		for (const string& path : ListFiles("./shaders"))
+			pack(path, true);
+
+		if (!PakArchive::Write(pakPath, inputs))
+			return 1;
+		printf("%zu files packed into %s\n", inputs.size(), pakPath.c_str());
+	}
+
+	return failed == 0 ? 0 : 1;
+}